@@ -0,0 +1,698 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pwd.h>
+#include <string.h>
+#include <grp.h>
+#include <time.h>
+#include "myfileops.h"
+
+/* ---------------------------------------------------------------- mycp */
+
+// -1 없음, 0 디렉터리, 1 일반 파일, 2 심볼릭 링크, -2 오류
+static int cpFileType(const char* file){
+    struct stat statbuf;
+
+    if (stat(file, &statbuf) < 0) {
+        if (errno == ENOENT) {
+            return -1;
+        }
+        else {
+            perror("Stat error");
+            return -2;
+        }
+    }
+
+    switch (statbuf.st_mode & S_IFMT)
+    {
+    case (S_IFDIR): // 디렉터리
+        return 0;
+    case (S_IFREG): // 일반 파일
+        return 1;
+    case (S_IFLNK): // 심볼릭 링크
+        return 2;
+    default:
+        fprintf(stderr,"Unsupported file type\n");
+        return -2;
+    }
+}
+
+static int setPermissionOfdest(const char* src, const char* dest) {
+    struct stat src_stat;
+
+    if (stat(src, &src_stat) < 0) {
+        perror("Stat error on source file");
+        return -1;
+    }
+
+    if(chmod(dest,src_stat.st_mode)<0){
+        perror("Chmod Error");
+        return -1;
+    }
+    return 0;
+}
+
+static int openSymboliclink(const char* symlink){
+    char target[1024];
+    int len;
+
+    len = readlink(symlink, target, sizeof(target)-1);
+    if(len <0){
+        perror("Readlink Error");
+        return -1;
+    }
+
+    target[len]='\0';
+
+    if(cpFileType(target)!=1){
+        fprintf(stderr, "This is not a regular file\n");
+        return -1;
+    }
+
+    return open(target, O_RDONLY | O_CLOEXEC);
+}
+
+static int openSource(const char* src){
+    int src_fd = -1;
+
+    // src 타입 검사
+    switch(cpFileType(src)){
+        case 0: // 디렉터리인 경우
+            fprintf(stderr, "mycp: -r not specified; omitting directory '%s'\n", src);
+            return -1;
+        case 1: // 일반 파일인 경우
+            src_fd = open(src, O_RDONLY | O_CLOEXEC);
+            if (src_fd < 0) {
+                fprintf(stderr, "mycp: cannot open '%s' for reading: ", src);
+                perror("");
+            }
+            return src_fd;
+        case 2: // 심볼릭 파일인 경우
+            return openSymboliclink(src);
+        case -1:
+            fprintf(stderr, "mycp: cannot stat '%s': No such file or directory\n", src);
+            return -1;
+        default:
+            return -1;
+    }
+}
+
+int doCopy(const char* src, const char* dest){
+
+    int src_fd, dest_fd;
+    char buffer[64 * 1024];
+    ssize_t contains;
+
+// dest 타입 검사
+    switch(cpFileType(dest)){
+        case -1:    // 파일이 없는 경우
+            // src를 먼저 열어 보고, 실패하면 빈 dest를 만들지 않는다
+            src_fd = openSource(src);
+            if (src_fd < 0) {
+                return -1;
+            }
+            dest_fd = open(dest, O_WRONLY | O_TRUNC | O_CREAT | O_CLOEXEC, 0600);
+            if (dest_fd < 0) {
+                fprintf(stderr, "mycp: cannot create regular file '%s': ", dest);
+                perror("");
+                close(src_fd);
+                return -1;
+            }
+            if (setPermissionOfdest(src, dest) < 0) {
+                close(src_fd);
+                close(dest_fd);
+                return -1;
+            }
+            break;
+        case 0: { // 디렉터리인 경우
+            char newDestPath[4096];
+            struct stat pathStat;
+            const char* base = strrchr(src, '/') ? strrchr(src, '/') + 1 : src;
+
+            // dest/src이름 (상대 경로는 현재 디렉터리 기준이므로 그대로 쓴다)
+            if ((size_t)snprintf(newDestPath, sizeof(newDestPath), "%s%s%s", dest,
+                                 dest[strlen(dest) - 1] == '/' ? "" : "/", base) >= sizeof(newDestPath)) {
+                fprintf(stderr, "Error: Path is too long\n");
+                return -1;
+            }
+
+            // 권한 검사
+            if (access(dest, W_OK | X_OK) < 0) {
+                fprintf(stderr, "mycp: cannot stat '%s/%s': ", dest, src);
+                perror("");
+                return -1;
+            }
+
+            // 파일 이름이 디렉터리로 존재하는지 확인
+            if (stat(newDestPath, &pathStat) == 0 && S_ISDIR(pathStat.st_mode)) {
+                fprintf(stderr, "mycp: cannot overwrite directory '%s/%s' with non-directory\n",dest,src);
+                return -1;
+            }
+
+            return doCopy(src, newDestPath);
+        }
+        case 1:     //일반 파일인 경우
+            src_fd = openSource(src);
+            if (src_fd < 0) {
+                return -1;
+            }
+            dest_fd = open(dest, O_WRONLY | O_TRUNC | O_CLOEXEC);
+            if (dest_fd < 0) {
+                fprintf(stderr, "mycp: cannot open '%s' for writing: ", dest);
+                perror("");
+                close(src_fd);
+                return -1;
+            }
+            break;
+        case -2:
+            return -1;
+        default:
+            fprintf(stderr, "Unsupported file type\n");
+            return -1;
+    }
+
+    // 복사
+    while ((contains = read(src_fd, buffer, sizeof(buffer))) > 0) {
+         if (write(dest_fd, buffer, contains) != contains) {
+            perror("Write error");
+            close(src_fd);
+            close(dest_fd);
+            return -1;
+        }
+    }
+
+    if (contains < 0) {
+        perror("Read error");
+    }
+
+    close(src_fd);
+    close(dest_fd);
+    return contains < 0 ? -1 : 0;
+}
+
+// 옵션은 지원하지 않는다 (getopt는 전역 상태를 쓰므로 직접 검사)
+int mycpHandles(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int mycpMain(int argc, char* argv[]) {
+
+    if (!mycpHandles(argc, argv)) {
+        fprintf(stderr, "Unsupported options\n");
+        return EXIT_FAILURE;
+    }
+
+    switch(argc){
+        case 1:
+            fprintf(stderr, "mycp: missing file operand\n");
+            return EXIT_FAILURE;
+        case 2:
+            fprintf(stderr, "mycp: missing destinantion file operand after '%s'\n", argv[1]);
+            return EXIT_FAILURE;
+        case 3:
+            return doCopy(argv[1], argv[2]) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+        default:
+            if (cpFileType(argv[argc-1])){
+                fprintf(stderr, "mycp: target '%s' is not a directory\n",argv[argc-1]);
+                return EXIT_FAILURE;
+            }
+            for(int i=1;i<argc-1;++i){
+                if (doCopy(argv[i],argv[argc-1]) < 0) {
+                    return EXIT_FAILURE;
+                }
+            }
+            return EXIT_SUCCESS;
+    }
+}
+
+/* ---------------------------------------------------------------- myls */
+
+// dirName/fileName. dirName이 NULL이면 (명령줄에 준 파일) fileName 그대로
+static void joinPath(char *out, size_t size, const char *dirName, const char *fileName) {
+    if (dirName == NULL) {
+        snprintf(out, size, "%s", fileName);
+    } else {
+        snprintf(out, size, "%s/%s", dirName, fileName);
+    }
+}
+
+// 파일 권한을 문자열로 변환
+static void getPermissions(mode_t mode, char *perm) {
+    perm[0] = (S_ISDIR(mode)) ? 'd' :
+              (S_ISLNK(mode)) ? 'l' :
+              (S_ISCHR(mode)) ? 'c' :
+              (S_ISBLK(mode)) ? 'b' :
+              (S_ISSOCK(mode)) ? 's' :
+              (S_ISFIFO(mode)) ? 'p' : '-';
+    perm[1] = (mode & S_IRUSR) ? 'r' : '-';
+    perm[2] = (mode & S_IWUSR) ? 'w' : '-';
+    perm[3] = (mode & S_IXUSR) ? 'x' : '-';
+    perm[4] = (mode & S_IRGRP) ? 'r' : '-';
+    perm[5] = (mode & S_IWGRP) ? 'w' : '-';
+    perm[6] = (mode & S_IXGRP) ? 'x' : '-';
+    perm[7] = (mode & S_IROTH) ? 'r' : '-';
+    perm[8] = (mode & S_IWOTH) ? 'w' : '-';
+    perm[9] = (mode & S_IXOTH) ? 'x' : '-';
+    perm[10] = '\0'; // 문자열 종료
+}
+
+// -F 표시 문자
+static char lsTypeChar(const char *fileName, const char *dirName) {
+    struct stat statbuf;
+    char fullPath[4096];
+
+    // 전체 경로 생성
+    joinPath(fullPath, sizeof(fullPath), dirName, fileName);
+
+    // 심볼릭 링크 자체 정보를 가져오기 위해 lstat 사용
+    if (lstat(fullPath, &statbuf) < 0) {
+        perror("Stat error");
+        return ' ';
+    }
+
+    // 파일 타입 판별
+    switch (statbuf.st_mode & S_IFMT) {
+    case S_IFDIR: // 디렉터리
+        return '/';
+    case S_IFREG: // 일반 파일
+        if (statbuf.st_mode & S_IXUSR) { // 실행 파일
+            return '*';
+        }
+        return ' ';
+    case S_IFLNK: // 심볼릭 링크
+        return '@';
+    case S_IFSOCK: // 소켓
+        return '=';
+    case S_IFIFO: // FIFO 파이프
+        return '|';
+    case S_IFCHR: // 문자 장치 파일
+    case S_IFBLK: // 블록 장치 파일
+        return '>';
+    default:
+        fprintf(stderr, "Unsupported file type\n");
+        return ' ';
+    }
+}
+
+static blksize_t getFileSize(const char* fileName, const char* dirName){
+    struct stat statbuf;
+    char fullPath[4096];
+
+    joinPath(fullPath, sizeof(fullPath), dirName, fileName);
+     if (lstat(fullPath, &statbuf) == 0) {
+        if (S_ISLNK(statbuf.st_mode)) {
+            return 0;   // 심볼릭 링크 0
+        }
+        return statbuf.st_blocks / 2;
+    }
+     else {
+        return 0;
+    }
+}
+
+static blksize_t getTotal(const char *dirName, const int flags[]){
+    blksize_t total = 0;
+    struct dirent *direntry;
+
+    DIR* dir=opendir(dirName);
+
+    if (dir == NULL) {
+        return 0;
+    }
+
+    while ((direntry = readdir(dir)) != NULL) {
+        if (flags[0] || direntry->d_name[0] != '.') {
+            total += getFileSize(direntry->d_name, dirName); // 블록 크기 합산
+        }
+    }
+    closedir(dir);
+    return total;
+}
+
+// 캐시에서 id의 이름을 찾고, 없으면 조회해서 넣는다 (이름이 없는 id는 숫자로)
+static const char *lookupName(NAMEENTRY **entries, int *num, int *cap, unsigned int id, int isGroup) {
+    char buf[4096];
+    char *name = NULL;
+
+    for (int i = 0; i < *num; ++i) {
+        if ((*entries)[i].id == id) {
+            return (*entries)[i].name;
+        }
+    }
+
+    if (isGroup) {
+        struct group grp, *result = NULL;
+        if (getgrgid_r(id, &grp, buf, sizeof(buf), &result) == 0 && result) {
+            name = strdup(result->gr_name);
+        }
+    } else {
+        struct passwd pwd, *result = NULL;
+        if (getpwuid_r(id, &pwd, buf, sizeof(buf), &result) == 0 && result) {
+            name = strdup(result->pw_name);
+        }
+    }
+    if (name == NULL) {
+        snprintf(buf, sizeof(buf), "%u", id);
+        name = strdup(buf);
+    }
+
+    if (*num == *cap) {
+        *cap = *cap ? *cap * 2 : 8;
+        *entries = realloc(*entries, *cap * sizeof(NAMEENTRY));
+    }
+    (*entries)[*num].id = id;
+    (*entries)[*num].name = name;
+    (*num)++;
+    return name;
+}
+
+void freeNameCache(NAMECACHE *cache) {
+    for (int i = 0; i < cache->userNum; ++i) {
+        free(cache->users[i].name);
+    }
+    for (int i = 0; i < cache->groupNum; ++i) {
+        free(cache->groups[i].name);
+    }
+    free(cache->users);
+    free(cache->groups);
+    memset(cache, 0, sizeof(NAMECACHE));
+}
+
+static void operateLOption(const char *fileName, const char *dirName, const int flags[], NAMECACHE *cache){
+    struct stat statbuf;
+    char fullPath[4096];
+    char perm[11];
+    char timeStr[32];
+    struct tm tmbuf;
+
+    joinPath(fullPath, sizeof(fullPath), dirName, fileName);
+
+    if (lstat(fullPath, &statbuf) < 0) {
+        perror("lstat error");
+        return;
+    }
+
+    // 권한
+    getPermissions(statbuf.st_mode, perm);
+
+    // 링크 수
+    printf("%s %ld ", perm, (long)statbuf.st_nlink);
+
+    // 소유자와 그룹 (캐시)
+    printf("%s %s ", lookupName(&cache->users, &cache->userNum, &cache->userCap, statbuf.st_uid, 0),
+           lookupName(&cache->groups, &cache->groupNum, &cache->groupCap, statbuf.st_gid, 1));
+
+    // 파일 크기
+    printf("%5ld ", (long)statbuf.st_size);
+
+    // 마지막 수정 시간 (ctime과 같은 "Mon dd hh:mm" 형식)
+    if (localtime_r(&statbuf.st_mtime, &tmbuf) && strftime(timeStr, sizeof(timeStr), "%b %e %H:%M", &tmbuf)) {
+        printf("%.12s ", timeStr);
+    } else {
+        perror("ctime error");
+    }
+
+    // 파일 이름
+    printf("%s", fileName);
+
+    // 심볼릭 링크 처리
+    if (S_ISLNK(statbuf.st_mode)) {
+        char linkTarget[4096];
+        ssize_t len = readlink(fullPath, linkTarget, sizeof(linkTarget) - 1);
+        if (len != -1) {
+            linkTarget[len] = '\0';
+            printf(" -> %s", linkTarget);
+
+            // 링크 대상의 파일 타입 확인
+            struct stat targetStat;
+            if (stat(linkTarget, &targetStat) == 0) {
+                if (flags[3]) { // -F 옵션
+                    if (S_ISDIR(targetStat.st_mode)) {
+                        printf("/");
+                    } else if (S_ISREG(targetStat.st_mode) && (targetStat.st_mode & S_IXUSR)) {
+                        printf("*");
+                    } else if (S_ISSOCK(targetStat.st_mode)) {
+                        printf("=");
+                    } else if (S_ISFIFO(targetStat.st_mode)) {
+                        printf("|");
+                    } else if (S_ISCHR(targetStat.st_mode) || S_ISBLK(targetStat.st_mode)) {
+                        printf(">");
+                    }
+                }
+            }
+        }
+    } else if(flags[3]){
+        printf("%c", lsTypeChar(fileName, dirName));
+    }
+
+     printf("\n");
+}
+
+static int reverse_alphasort(const struct dirent **a, const struct dirent **b){
+    return strcmp((*b)->d_name, (*a)->d_name);
+}
+
+int doLs(const char *dirName, const int flags[], NAMECACHE *cache) {
+    struct dirent **namelist;
+    int n;
+
+    // -r 옵션
+    if(flags[6]){
+        n = scandir(dirName, &namelist, NULL, reverse_alphasort);
+    } else{
+        n = scandir(dirName, &namelist, NULL, alphasort);
+    }
+
+    if (n < 0) {
+        fprintf(stderr, "myls: cannot open directory '%s': ",dirName);
+        perror("");
+        return -1;
+    }
+
+    // -R 옵션
+    if (flags[5]) {
+        printf("%s:\n", dirName);
+    }
+
+    // -s 또는 -l 옵션일 때 total 출력
+    if (flags[2] || flags[4]) {
+        blksize_t totalBlocks = getTotal(dirName, flags);
+        printf("total %ld\n", (long)totalBlocks);
+    }
+
+    // 디렉터리 항목 출력 (출력이 실패하면(EPIPE 등) 나머지는 건너뛴다)
+    int writeFailed = 0;
+    for (int i = 0; i < n; i++) {
+        if (writeFailed || (!flags[0] && namelist[i]->d_name[0] == '.')) {   // a 옵션
+            free(namelist[i]);
+            continue;
+        }
+
+        if(flags[1]){   // i 옵션
+                printf("%ld ", (long)namelist[i]->d_ino);
+            }
+        if(flags[2]){   // s 옵션
+                printf(" %ld ", (long)getFileSize(namelist[i]->d_name, dirName));
+        }
+
+        if (flags[4]) { // -l 옵션
+            operateLOption(namelist[i]->d_name, dirName, flags, cache);
+        } else {
+            printf("%s", namelist[i]->d_name);
+            if (flags[3]) { // -F 옵션
+                printf("%c  ", lsTypeChar(namelist[i]->d_name, dirName));
+            } else {
+                printf("  ");
+            }
+        }
+        free(namelist[i]);
+        writeFailed = ferror(stdout);
+    }
+
+    if(!flags[4]){
+        printf("\n");
+    }
+
+    free(namelist);
+    if (writeFailed || ferror(stdout)) {
+        return -1;
+    }
+
+    // -R 옵션
+    if (flags[5]) {
+        n = scandir(dirName, &namelist, NULL, alphasort);
+        for (int i = 0; i < n; i++) {
+            if (writeFailed || (!flags[0] && namelist[i]->d_name[0] == '.')) {
+                free(namelist[i]);
+                continue;
+            }
+
+            char fullPath[4096];
+            snprintf(fullPath, sizeof(fullPath), "%s/%s", dirName, namelist[i]->d_name);
+
+            struct stat statbuf;
+            if (lstat(fullPath, &statbuf) < 0) {
+                perror("lstat error");
+                free(namelist[i]);
+                continue;
+            }
+
+            if (S_ISDIR(statbuf.st_mode) &&
+                strcmp(namelist[i]->d_name, ".") != 0 &&
+                strcmp(namelist[i]->d_name, "..") != 0) {
+                printf("\n");
+                doLs(fullPath, flags, cache);
+                writeFailed = ferror(stdout);
+            }
+
+            free(namelist[i]);
+        }
+
+        if (n >= 0) {
+            free(namelist);
+        }
+    }
+    return writeFailed ? -1 : 0;
+}
+
+// 명령줄에 준 디렉터리가 아닌 파일 하나 (ls처럼 이름만, 또는 -l 형식으로)
+static void lsFile(const char *name, const int flags[], NAMECACHE *cache) {
+    struct stat statbuf;
+
+    if(flags[1] && lstat(name, &statbuf) == 0){   // i 옵션
+        printf("%ld ", (long)statbuf.st_ino);
+    }
+    if(flags[2]){   // s 옵션
+        printf(" %ld ", (long)getFileSize(name, NULL));
+    }
+    if (flags[4]) { // -l 옵션
+        operateLOption(name, NULL, flags, cache);
+    } else {
+        printf("%s", name);
+        if (flags[3]) { // -F 옵션
+            printf("%c  ", lsTypeChar(name, NULL));
+        } else {
+            printf("  ");
+        }
+    }
+}
+
+static int parseLsOptions(int argc, char* argv[], int optflags[], int *operands) {
+    const char *optchars = "aisFlRr";
+    int endOfOptions = 0;
+
+    // getopt는 전역 상태를 쓰므로 직접 옵션을 읽는다 (-la 처럼 묶어 써도 된다)
+    *operands = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (endOfOptions || argv[i][0] != '-' || argv[i][1] == '\0') {
+            (*operands)++;
+            continue;
+        }
+        if (!strcmp(argv[i], "--")) {
+            endOfOptions = 1;
+            continue;
+        }
+        for (const char *p = argv[i] + 1; *p; ++p) {
+            const char *opt = strchr(optchars, *p);
+            if (opt == NULL) {
+                return -1;
+            }
+            optflags[opt - optchars] = 1;
+        }
+    }
+    return 0;
+}
+
+// 지원하는 옵션(a, i, s, F, l, R, r)만 쓰였는지
+int mylsHandles(int argc, char* argv[]) {
+    int optflags[LS_FLAGS] = {0};
+    int operands;
+
+    return parseLsOptions(argc, argv, optflags, &operands) == 0;
+}
+
+// operand가 옵션이 아닌 인자인지 (-- 뒤는 모두 인자)
+static int isLsOperand(char* argv[], int i, int *endOfOptions) {
+    if (!*endOfOptions && !strcmp(argv[i], "--")) {
+        *endOfOptions = 1;
+        return 0;
+    }
+    return *endOfOptions || argv[i][0] != '-' || argv[i][1] == '\0';
+}
+
+int mylsMain(int argc, char* argv[], NAMECACHE *cache){
+    int optflags[LS_FLAGS]={0};    // 순서대로 a, i, s, F, l, R, r
+    int operands = 0;
+    int status = EXIT_SUCCESS;
+    int endOfOptions = 0;
+    int printed = 0;   // 앞에 출력한 것이 있으면 디렉터리 사이에 빈 줄
+
+    if (parseLsOptions(argc, argv, optflags, &operands) < 0) {
+        fprintf(stderr, "Unsupported options\n");
+        return EXIT_FAILURE;
+    }
+
+    if (operands == 0) {
+        return doLs(".", optflags, cache) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // ls처럼 디렉터리가 아닌 인자를 먼저 한꺼번에 보여 준다
+    for(int i = 1; i<argc && !ferror(stdout); ++i){
+        struct stat statbuf;
+
+        if (!isLsOperand(argv, i, &endOfOptions)) {
+            continue;
+        }
+        if (stat(argv[i], &statbuf) < 0 && lstat(argv[i], &statbuf) < 0) {
+            fprintf(stderr, "myls: cannot access '%s': ", argv[i]);
+            perror("");
+            status = EXIT_FAILURE;
+            continue;
+        }
+        if (!S_ISDIR(statbuf.st_mode)) {
+            lsFile(argv[i], optflags, cache);
+            printed = 1;
+        }
+    }
+    if (printed && !optflags[4]) {
+        printf("\n");
+    }
+
+    // 그다음 디렉터리. 인자가 여럿이면 (-R은 doLs가 직접) 이름을 제목으로 붙인다
+    endOfOptions = 0;
+    for(int i = 1; i<argc && !ferror(stdout); ++i){
+        struct stat statbuf;
+
+        if (!isLsOperand(argv, i, &endOfOptions)) {
+            continue;
+        }
+        if (stat(argv[i], &statbuf) < 0 || !S_ISDIR(statbuf.st_mode)) {
+            continue;
+        }
+        if (printed) {
+            printf("\n");
+        }
+        if (operands > 1 && !optflags[5]) {
+            printf("%s:\n",argv[i]);
+        }
+        if (doLs(argv[i], optflags, cache) < 0) {
+            status = EXIT_FAILURE;
+        }
+        printed = 1;
+    }
+    if (ferror(stdout)) {
+        status = EXIT_FAILURE;
+    }
+    return status;
+}
@@ -0,0 +1,46 @@
+#ifndef MYFILEOPS_H
+#define MYFILEOPS_H
+
+// mycp, myls의 엔진. 독립 실행 파일(mycp, myls)과 mysh의 cp, ls 빌트인이 함께 쓴다
+// gcc mycp.c myfileops.c -o mycp
+// gcc myls2345.c myfileops.c -o myls
+// gcc mysh.c myfileops.c -o mysh
+//
+// 오류가 나도 exit() 하지 않고 메시지를 출력한 뒤 실패를 반환한다
+// 전역 상태(getopt, getpwuid 등)를 쓰지 않으므로 한 프로세스에서 몇 번이고 다시 부를 수 있다
+
+#include <sys/types.h>
+
+// uid/gid -> 이름 캐시. 호출 사이에 유지하면 NSS 조회(/etc/passwd 읽기)를 한 번만 한다
+typedef struct NAMEENTRY {
+    unsigned int id;
+    char *name;
+} NAMEENTRY;
+
+typedef struct NAMECACHE {
+    NAMEENTRY *users;
+    int userNum;
+    int userCap;
+    NAMEENTRY *groups;
+    int groupNum;
+    int groupCap;
+} NAMECACHE;
+
+// ls 옵션 순서: a, i, s, F, l, R, r
+#define LS_FLAGS 7
+
+// 성공 0, 실패 -1
+int doCopy(const char* src, const char* dest);
+int doLs(const char *dirName, const int flags[], NAMECACHE *cache);
+
+// 명령 전체 (인자 검사, 옵션 처리). 종료 상태(EXIT_SUCCESS, EXIT_FAILURE)를 반환
+int mycpMain(int argc, char* argv[]);
+int mylsMain(int argc, char* argv[], NAMECACHE *cache);
+
+// 엔진이 처리할 수 있는 옵션만 쓰였으면 1. 아니면 셸은 외부 명령(cp, ls)을 실행한다
+int mycpHandles(int argc, char* argv[]);
+int mylsHandles(int argc, char* argv[]);
+
+void freeNameCache(NAMECACHE *cache);
+
+#endif
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -6,6 +7,24 @@
 #include <sys/wait.h>
 #include <error.h>
 #include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/uio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <dirent.h>
+#include "myfileops.h"
+
+extern char **environ;
 
 typedef struct CMD
 {
@@ -19,7 +38,17 @@ int cmd_pwd(int argc, char *arv[]);
 int cmd_exit(int argc, char *arv[]);
 int cmd_help(int argc, char *arv[]);
 int cmd_history(int argc, char *arv[]);
+int cmd_jobs(int argc, char *arv[]);
+int cmd_fg(int argc, char *arv[]);
+int cmd_bg(int argc, char *arv[]);
+int cmd_wait(int argc, char *arv[]);
+int cmd_parallel(int argc, char *arv[]);
+int cmd_cp(int argc, char *arv[]);
+int cmd_ls(int argc, char *arv[]);
+int cmd_time(int argc, char *arv[]);
+int cmd_stats(int argc, char *arv[]);
 int cmdProcessing(void);
+char *readScriptLine(void);
 void add_history(char *command);
 int cmd_test(int argc, char *arv[]);
 
@@ -29,50 +58,564 @@ CMD builtin[] = {
     {"exit", "셸 실행을 종료합니다", cmd_exit},
     {"help", "도움말 보여 주기", cmd_help},
     {"history", "명령어 기록 보여 주기", cmd_history},
+    {"jobs", "작업 목록 보여 주기", cmd_jobs},
+    {"fg", "작업을 포그라운드로 가져오기", cmd_fg},
+    {"bg", "멈춘 작업을 백그라운드에서 계속 실행", cmd_bg},
+    {"wait", "백그라운드 작업이 끝날 때까지 기다리기", cmd_wait},
+    {"parallel", "명령을 여러 개 동시에 실행하기", cmd_parallel},
+    {"cp", "파일 복사 (mycp, 셸 안에서 실행)", cmd_cp},
+    {"ls", "디렉터리 목록 (myls, 셸 안에서 실행)", cmd_ls},
+    {"time", "파이프라인의 실행 시간과 자원 사용량 보기", cmd_time},
+    {"stats", "명령 실행 지연 히스토그램 (on, off, reset, trace 파일)", cmd_stats},
     {"hello", "테스트", cmd_test}};
 const int builtins = sizeof(builtin) / sizeof(CMD);
 
-int main(void)
+void initJobControl(void);
+void initHistory(void);
+int openScript(const char *path);
+void openCommandString(const char *cmd);
+void openStdinScript(void);
+void initStats(void);
+void closeTrace(void);
+
+extern int interactive;
+extern int lastStatus;
+
+// mysh                 대화형 (stdin이 터미널이 아니면 stdin을 스크립트로 읽음)
+// mysh script.sh       스크립트 파일 실행
+// mysh -c '명령'       문자열 실행
+int main(int argc, char *argv[])
 {
     int isExit = 0;
 
+    if (argc >= 2 && !strcmp(argv[1], "-c"))
+    {
+        if (argc < 3)
+        {
+            fprintf(stderr, "mysh: -c: option requires an argument\n");
+            return 2;
+        }
+        openCommandString(argv[2]);
+    }
+    else if (argc >= 2)
+    {
+        if (openScript(argv[1]) < 0)
+            return 127;
+    }
+    else if (isatty(STDIN_FILENO))
+    {
+        interactive = 1;
+    }
+    else
+    {
+        openStdinScript();
+    }
+
+    // 빌트인이 닫힌 파이프에 써도 셸이 죽지 않도록, 파이프라인에 터미널을 넘길 수 있도록
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+    initJobControl();
+    initStats();
+
+    // 기록은 대화형일 때만 쓴다 (스크립트 실행에는 파일을 열 필요도 없다)
+    if (interactive)
+        initHistory();
+
     while (!isExit)
         isExit = cmdProcessing();
-    fputs("My Shell을 종료합니다\n", stdout);
-    return 0;
+    if (interactive)
+        fputs("My Shell을 종료합니다\n", stdout);
+    closeTrace();
+    return lastStatus;
 }
 
 #define STR_LEN 1024
-#define MAX_TOKENS 128
-#define MAX_LINE 5
+#define MAX_STAGES 64
+#define ARENA_BLOCK (64 * 1024)
 
-// 기록을 저장할 큐
-typedef struct HISTORY
+// 한 줄을 처리하는 동안 쓰는 메모리 (토큰, 구문 트리)
+// 덧붙이기만 하고 명령마다 한 번에 비운다
+typedef struct ARENABLOCK
+{
+    struct ARENABLOCK *next;
+    size_t cap;
+    size_t used;
+    char data[];
+} ARENABLOCK;
+
+typedef struct ARENA
+{
+    ARENABLOCK *head;
+} ARENA;
+
+// NULL로 끝나는 포인터 배열 (아레나에서 두 배씩 늘린다)
+typedef struct VEC
 {
+    void **items;
     int num;
-    char command[STR_LEN];
+    int cap;
+} VEC;
+
+enum
+{
+    REDIR_IN,     // n<file
+    REDIR_OUT,    // n>file
+    REDIR_APPEND, // n>>file
+    REDIR_DUP     // n>&m
+};
+
+typedef struct REDIR
+{
+    int fd;
+    int type;
+    char *target;
+    int dupFd;
+    struct REDIR *next;
+} REDIR;
+
+// 파이프라인의 한 단계 (명령어 하나와 그 리다이렉션)
+typedef struct STAGE
+{
+    char **argv;
+    int argc;
+    REDIR *redirs;
+    int expand;   // 실행할 때 바꿔야 할 단어가 있음 ($?)
+    char **globs; // globs[i]가 NULL이 아니면 argv[i]는 glob 패턴 (패턴이 없으면 NULL)
+} STAGE;
+
+// 앞 파이프라인과의 연결
+enum
+{
+    OP_SEQ, // ; 또는 줄의 처음
+    OP_AND, // &&
+    OP_OR   // ||
+};
+
+typedef struct PIPELINE
+{
+    STAGE **stages;
+    int stageNum;
+    int op;
+    int background;
+} PIPELINE;
+
+// 한 줄 = 파이프라인 목록
+typedef struct CMDLIST
+{
+    PIPELINE **pipes;
+    int pipeNum;
+} CMDLIST;
+
+#define MAX_JOBS 64
+
+enum
+{
+    PROC_RUNNING,
+    PROC_STOPPED,
+    PROC_DONE
+};
+
+// 외부 명령 하나의 시점 (CLOCK_MONOTONIC, ns)
+// setup: spawnCommand 진입 ~ posix_spawn 호출 (PATH 검색, file action 준비)
+// spawn: posix_spawn 호출 ~ 반환. CLONE_VFORK라 자식의 execve가 성공해야 돌아오므로 clone과 exec를 함께 잰다
+// run:   posix_spawn 반환 ~ 셸이 종료 상태를 회수한 시점
+typedef struct SPAWNTIME
+{
+    uint64_t start;
+    uint64_t spawn;
+    uint64_t run;
+} SPAWNTIME;
+
+// 작업(job) = 하나의 프로세스 그룹으로 실행된 파이프라인
+typedef struct JOB
+{
+    int id; // 0이면 빈 칸
+    pid_t pgid;
+    int procNum;
+    pid_t pids[MAX_STAGES]; // 빌트인 단계는 -1
+    int state[MAX_STAGES];
+    int status[MAX_STAGES]; // waitpid 상태 값
+    int background;
+    char *cmd;
+    SPAWNTIME times[MAX_STAGES];
+} JOB;
+
+void *arenaAlloc(ARENA *arena, size_t size);
+void arenaReset(ARENA *arena);
+CMDLIST *parseLine(char *line, ARENA *arena);
+void runList(CMDLIST *list);
+int runPipeline(PIPELINE *pl);
+int findBuiltin(const char *name);
+void reapJobs(void);
+void notifyJobs(void);
+void waitForInput(void);
+int waitForJob(JOB *job);
+pid_t spawnCommand(char *argv[], const int fds[3], pid_t pgid, SPAWNTIME *times);
+void resetGlobCache(void);
+
+// 스크립트 입력. 파일은 mmap (MAP_PRIVATE라 줄 끝에 NULL 문자를 써도 파일은 그대로)
+// 파이프 등 mmap 할 수 없는 입력은 큰 블록으로 읽어 줄을 나눈다
+typedef struct INPUT
+{
+    char *data;
+    size_t size; // data에 들어 있는 바이트 수
+    size_t pos;  // 다음 줄의 시작
+    size_t cap;  // 블록 버퍼 크기 (mmap이면 0)
+    int fd;      // 블록으로 읽을 디스크립터 (-1이면 data가 전부)
+    int seekFd;  // 자식이 이어서 읽을 수 있도록 줄마다 위치를 맞출 디스크립터 (mmap 한 stdin)
+    size_t mapped;
+} INPUT;
+
+#define INPUT_BLOCK (256 * 1024)
+
+JOB jobs[MAX_JOBS];
+INPUT input = {NULL, 0, 0, 0, -1, -1, 0};
+ARENA lineArena;
+int lastStatus = 0; // $?
+int prevStatus = 0; // 빌트인이 lastStatus를 0으로 되돌리기 전의 $? (인자 없는 exit가 쓴다)
+int exitShell = 0;
+int interactive = 0;
+int sigchldPipe[2] = {-1, -1};
+
+static void closeFd(int *fd)
+{
+    if (*fd >= 0)
+        close(*fd);
+    *fd = -1;
+}
+
+// 명령어 기록은 두 파일로 디스크에 남는다 (여러 셸이 동시에 써도 안전)
+//  - 로그: 명령을 한 줄씩 덧붙이기만 하는 텍스트 파일. 항목마다 크기 제한이 없다
+//  - 색인: 항목마다 16바이트 (로그 안 위치, 길이, 앞 4바이트)
+// 둘 다 mmap 해서 쓰므로 시작할 때 읽어 들이는 것이 없다 (항목 수와 무관하게 O(1))
+typedef struct HISTENTRY
+{
+    uint64_t off;
+    uint32_t len;
+    uint32_t prefix; // 앞 4바이트, 접두어 검색 때 로그를 건드리지 않고 거른다
+} HISTENTRY;
+
+typedef struct HISTORY
+{
+    int logFd;
+    int idxFd;
+    char *log;
+    size_t logSize;
+    HISTENTRY *idx;
+    size_t idxSize;
+    size_t num; // 항목 수 (!n의 n은 1부터)
 } HISTORY;
 
-HISTORY history[MAX_LINE];
-int head = 0;
-int count = 0;
-int total_count = 0;
+HISTORY history = {-1, -1, NULL, 0, NULL, 0, 0};
 
-void add_history(char *command)
+// 파일 크기가 바뀌었으면 매핑을 다시 맞춘다
+static void remapFile(int fd, void **addr, size_t *mapped)
+{
+    struct stat st;
+    void *p;
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size == *mapped)
+        return;
+
+    if (*mapped == 0)
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    else if (st.st_size == 0)
+        p = (munmap(*addr, *mapped), NULL);
+    else
+        p = mremap(*addr, *mapped, st.st_size, MREMAP_MAYMOVE);
+
+    if (p == MAP_FAILED)
+        return;
+    *addr = p;
+    *mapped = p ? st.st_size : 0;
+}
+
+// 다른 셸이 덧붙인 항목까지 보이도록 매핑을 갱신한다
+static void refreshHistory(void)
 {
-    int currentIdx = (head + count) % MAX_LINE;
-    strncpy(history[currentIdx].command, command, STR_LEN - 1);
-    history[currentIdx].command[STR_LEN - 1] = '\0';
-    history[currentIdx].num = ++total_count;
+    if (history.logFd < 0)
+        return;
+    remapFile(history.logFd, (void **)&history.log, &history.logSize);
+    remapFile(history.idxFd, (void **)&history.idx, &history.idxSize);
+    history.num = history.idxSize / sizeof(HISTENTRY);
 
-    if (count == MAX_LINE)
+    // 색인은 로그보다 나중에 쓰므로 항상 완성된 로그 항목만 가리킨다
+    // 그래도 로그가 잘렸다면 매핑 밖의 항목은 보지 않는다
+    while (history.num > 0 &&
+           history.idx[history.num - 1].off + history.idx[history.num - 1].len > history.logSize)
+        history.num--;
+}
+
+static uint32_t packPrefix(const char *s, size_t len)
+{
+    uint32_t prefix = 0;
+
+    memcpy(&prefix, s, len < 4 ? len : 4);
+    return prefix;
+}
+
+static void appendIndex(uint64_t off, const char *s, uint32_t len)
+{
+    HISTENTRY entry = {off, len, packPrefix(s, len)};
+
+    if (write(history.idxFd, &entry, sizeof(entry)) != sizeof(entry))
+        perror("history");
+}
+
+// 색인이 로그를 따라오지 못한 경우 (처음 실행, 색인 삭제, 쓰는 도중 종료) 뒤쪽만 다시 색인한다
+// 잠금을 잡은 상태에서 호출해야 한다
+static void recoverHistory(void)
+{
+    uint64_t end = 0;
+
+    refreshHistory();
+    if (history.idxSize % sizeof(HISTENTRY) != 0)
+    {
+        // 쓰다 만 마지막 항목만 잘라 내고 매핑 크기도 맞춘다 (아래의 전체 재색인 조건에 걸리지 않도록)
+        ftruncate(history.idxFd, history.num * sizeof(HISTENTRY));
+        refreshHistory();
+    }
+    if (history.num > 0)
+        end = history.idx[history.num - 1].off + history.idx[history.num - 1].len + 1;
+    if (history.num * sizeof(HISTENTRY) < history.idxSize || end > history.logSize)
+    {
+        // 색인이 로그와 맞지 않으면 처음부터 다시 만든다
+        ftruncate(history.idxFd, 0);
+        end = 0;
+    }
+
+    while (end < history.logSize)
     {
-        head = (head + 1) % MAX_LINE;
+        const char *start = history.log + end;
+        const char *nl = memchr(start, '\n', history.logSize - end);
+        if (nl == NULL)
+            break;
+        appendIndex(end, start, nl - start);
+        end += nl - start + 1;
     }
+    refreshHistory();
+}
+
+// $MYSH_HISTFILE, 없으면 ~/.mysh_history
+// 파일을 열 수 없으면 memfd를 써서 이번 세션 동안만 기록한다
+void initHistory(void)
+{
+    char path[PATH_MAX];
+    char idxPath[PATH_MAX + 8];
+    const char *env = getenv("MYSH_HISTFILE");
+    const char *home = getenv("HOME");
+
+    if (env && *env)
+        snprintf(path, sizeof(path), "%s", env);
+    else if (home)
+        snprintf(path, sizeof(path), "%s/.mysh_history", home);
     else
+        path[0] = '\0';
+    snprintf(idxPath, sizeof(idxPath), "%s.idx", path);
+
+    if (path[0])
+    {
+        history.logFd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+        history.idxFd = open(idxPath, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    }
+    if (history.logFd < 0 || history.idxFd < 0)
+    {
+        closeFd(&history.logFd);
+        closeFd(&history.idxFd);
+        history.logFd = memfd_create("mysh_history", MFD_CLOEXEC);
+        history.idxFd = memfd_create("mysh_history.idx", MFD_CLOEXEC);
+        if (history.logFd < 0 || history.idxFd < 0)
+        {
+            perror("history");
+            closeFd(&history.logFd);
+            closeFd(&history.idxFd);
+            return;
+        }
+    }
+
+    flock(history.logFd, LOCK_EX);
+    recoverHistory();
+    flock(history.logFd, LOCK_UN);
+}
+
+// 로그에 한 줄, 색인에 한 칸을 덧붙인다. 빈 줄은 남기지 않는다
+// 잠금 안에서 로그를 먼저 쓰므로 색인은 항상 완성된 항목만 가리킨다
+void add_history(char *command)
+{
+    struct stat st;
+    struct iovec iov[2];
+    size_t len = strcspn(command, "\n");
+
+    if (history.logFd < 0 || command[strspn(command, " \t\r\n")] == '\0')
+        return;
+
+    flock(history.logFd, LOCK_EX);
+    if (fstat(history.logFd, &st) == 0)
+    {
+        iov[0].iov_base = command;
+        iov[0].iov_len = len;
+        iov[1].iov_base = "\n";
+        iov[1].iov_len = 1;
+        if (writev(history.logFd, iov, 2) == (ssize_t)len + 1)
+            appendIndex(st.st_size, command, len);
+        else
+            perror("history");
+    }
+    flock(history.logFd, LOCK_UN);
+}
+
+// n번째 (1부터) 항목
+static const char *getHistory(size_t n, size_t *len)
+{
+    if (n < 1 || n > history.num)
+        return NULL;
+    *len = history.idx[n - 1].len;
+    return history.log + history.idx[n - 1].off;
+}
+
+// prefix로 시작하는 가장 최근 항목 번호, 없으면 0
+static size_t findHistoryPrefix(const char *prefix, size_t len)
+{
+    uint32_t want = packPrefix(prefix, len);
+    uint32_t mask = len >= 4 ? 0xffffffffu : 0;
+
+    // 색인의 앞 4바이트로 먼저 거르고, 남은 것만 로그와 비교한다
+    if (len < 4)
+        memset(&mask, 0xff, len);
+    for (size_t n = history.num; n > 0; --n)
+    {
+        const HISTENTRY *e = &history.idx[n - 1];
+        if ((e->prefix & mask) != want || e->len < len)
+            continue;
+        if (memcmp(history.log + e->off, prefix, len) == 0)
+            return n;
+    }
+    return 0;
+}
+
+// needle을 포함하는 가장 최근 항목 번호, 없으면 0
+static size_t findHistorySubstr(const char *needle, size_t len)
+{
+    for (size_t n = history.num; n > 0; --n)
+    {
+        const HISTENTRY *e = &history.idx[n - 1];
+        if (memmem(history.log + e->off, e->len, needle, len))
+            return n;
+    }
+    return 0;
+}
+
+// 로그 위치 off를 담은 항목 번호 (색인은 위치 순으로 정렬되어 있으므로 이진 탐색)
+static size_t historyAt(uint64_t off)
+{
+    size_t lo = 0, hi = history.num;
+
+    while (hi - lo > 1)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (history.idx[mid].off <= off)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo + 1;
+}
+
+// history -s: 로그 전체를 memmem 한 번으로 훑고, 찾은 위치를 색인으로 항목에 대응시킨다
+static void searchHistory(const char *needle)
+{
+    size_t len = strlen(needle);
+    const char *p = history.log;
+    const char *end;
+
+    if (history.num == 0 || len == 0)
+        return;
+    end = history.log + history.idx[history.num - 1].off + history.idx[history.num - 1].len;
+
+    while (p < end && (p = memmem(p, end - p, needle, len)) != NULL)
+    {
+        size_t n = historyAt(p - history.log);
+        const HISTENTRY *e = &history.idx[n - 1];
+
+        printf("%5zu  %.*s\n", n, (int)e->len, history.log + e->off);
+        p = history.log + e->off + e->len + 1;
+    }
+}
+
+// !!, !n, !-n, !prefix, !?str 를 기록의 명령으로 바꿔 out에 쓴다
+// out이 NULL이면 길이만 센다. 바뀐 줄의 길이, 찾지 못하면 -1
+long expandHistory(const char *line, char *out)
+{
+    size_t pos = 0;
+    int quoted = 0;
+
+    for (const char *p = line; *p;)
     {
-        count++;
+        const char *spec = p;
+        const char *text = NULL;
+        size_t textLen = 0;
+        size_t n = 0;
+
+        // 작은따옴표 안, \! , ! 뒤에 공백이나 = ( " 가 오면, 그리고 glob의 [! 는 바꾸지 않는다
+        if (*p == '\'')
+            quoted = !quoted;
+        if (*p == '\\' && p[1] == '!')
+        {
+            p++;
+        }
+        else if (*p == '!' && !quoted && p[1] && !strchr(" \t\r\n=(\"", p[1]) && !(p > line && p[-1] == '['))
+        {
+            p++;
+            if (*p == '!')
+            {
+                n = history.num;
+                p++;
+            }
+            else if (isdigit((unsigned char)*p) || (*p == '-' && isdigit((unsigned char)p[1])))
+            {
+                long v = strtol(p, (char **)&p, 10);
+                n = v < 0 ? (size_t)((long)history.num + v + 1) : (size_t)v;
+                if (v < 0 && -v > (long)history.num)
+                    n = 0;
+            }
+            else if (*p == '?')
+            {
+                const char *q = ++p;
+                while (*p && *p != '?' && *p != '\n')
+                    p++;
+                n = p > q ? findHistorySubstr(q, p - q) : 0;
+                if (*p == '?')
+                    p++;
+            }
+            else
+            {
+                const char *q = p;
+                while (*p && !strchr(" \t\r\n;|&<>()", *p))
+                    p++;
+                n = findHistoryPrefix(q, p - q);
+            }
+
+            text = getHistory(n, &textLen);
+            if (text == NULL)
+            {
+                int specLen = strcspn(spec, " \t\r\n");
+                fprintf(stderr, "mysh: %.*s: event not found\n", specLen, spec);
+                return -1;
+            }
+            if (out)
+                memcpy(out + pos, text, textLen);
+            pos += textLen;
+            continue;
+        }
+
+        if (out)
+            out[pos] = *p;
+        pos++;
+        p++;
     }
+    if (out)
+        out[pos] = '\0';
+    return pos;
 }
 
 int is_number(const char *str)
@@ -88,30 +631,30 @@ int is_number(const char *str)
 
 int cmd_history(int argc, char *argv[])
 {
-    int iter;
+    size_t iter;
 
+    refreshHistory();
     if (argc == 1)
     {
-        iter = count;
+        iter = history.num;
+    }
+    else if (argc == 3 && !strcmp(argv[1], "-s"))
+    {
+        // history -s 문자열: 문자열을 포함하는 항목을 모두 보여 준다
+        searchHistory(argv[2]);
+        return 0;
     }
     else if (argc == 2)
     {
         if (argv[1][0] == '-')
         {
-            fprintf(stderr, "옵션 지원 안함\n");
+            fprintf(stderr, "옵션 지원 안함 (-s 문자열 만 지원)\n");
             return 0;
         }
         else if (is_number(argv[1]))
         {
-            int requested = atoi(argv[1]);
-            if (requested > count)
-            {
-                iter = count;
-            }
-            else if (requested >= 0)
-            {
-                iter = requested;
-            }
+            long requested = atol(argv[1]);
+            iter = requested > (long)history.num ? history.num : (requested >= 0 ? (size_t)requested : 0);
         }
         else
         {
@@ -125,183 +668,3396 @@ int cmd_history(int argc, char *argv[])
         return 0;
     }
 
-    for (int i = count - iter; i < count; ++i)
+    for (size_t n = history.num - iter + 1; n <= history.num; ++n)
     {
-        int idx = (head + i) % MAX_LINE;
-        printf("%3d %s", history[idx].num, history[idx].command);
+        size_t len = 0;
+        const char *cmd = getHistory(n, &len);
+        if (cmd == NULL)
+            continue;
+        printf("%5zu  %.*s\n", n, (int)len, cmd);
     }
     return 0;
 }
 
-int cmdProcessing(void)
+// 줄이 && || | 로 끝나면 명령이 다음 줄로 이어진다 (\| 처럼 이스케이프된 것은 제외)
+static int lineContinues(const char *line)
 {
-    char cmdLine[STR_LEN];
-    char *cmdTokens[MAX_TOKENS];
-    char delim[] = " \t\n\r";
-    char *token;
-    int tokenNum;
-
-    int exitCode = 0;
-    fputs("[mysh v0.1] $ ", stdout);
-    fgets(cmdLine, STR_LEN, stdin);
-    add_history(cmdLine);
-
-    tokenNum = 0;
-    token = strtok(cmdLine, delim);
+    size_t len = strlen(line);
+    size_t backslashes = 0;
 
-    while (token)
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t' ||
+                       line[len - 1] == '\r' || line[len - 1] == '\n'))
+        len--;
+    if (len == 0)
+        return 0;
+    if (line[len - 1] == '&')
     {
-        cmdTokens[tokenNum++] = token;
-        token = strtok(NULL, delim);
+        if (len < 2 || line[len - 2] != '&')
+            return 0;
+        len--;
     }
-
-    cmdTokens[tokenNum] = NULL;
-    if (tokenNum == 0)
-        return exitCode;
-    for (int i = 0; i < builtins; ++i)
+    else if (line[len - 1] != '|')
     {
-        if (strcmp(cmdTokens[0], builtin[i].name) == 0)
-            return builtin[i].cmd(tokenNum, cmdTokens);
+        return 0;
     }
+    if (len >= 2 && line[len - 2] == line[len - 1])
+        len--;
+    while (backslashes < len - 1 && line[len - 2 - backslashes] == '\\')
+        backslashes++;
+    return backslashes % 2 == 0;
+}
 
-    pid_t pid;
+// head 뒤에 공백 하나를 두고 next를 붙인 새 줄 (arena)
+static char *joinLines(const char *head, size_t headLen, const char *next)
+{
+    size_t nextLen = strlen(next);
+    char *line = arenaAlloc(&lineArena, headLen + nextLen + 2);
 
-    pid = fork();
-    if (pid > 0)
-    {
-        int status; // 포인터로 설정하지 않아도 된다
-        waitpid(pid, &status, 0);
-    }
-    else if (pid == 0)
+    memcpy(line, head, headLen);
+    line[headLen] = ' ';
+    memcpy(line + headLen + 1, next, nextLen + 1);
+    return line;
+}
+
+int cmdProcessing(void)
+{
+    static char *cmdLine = NULL;
+    static size_t lineCap = 0;
+    char *text;
+    CMDLIST *list;
+
+    // 이전 줄의 토큰과 구문 트리를 한 번에 버린다
+    arenaReset(&lineArena);
+    resetGlobCache();
+
+    // 끝난 백그라운드 작업은 프롬프트를 찍기 전에 알려 준다
+    reapJobs();
+    notifyJobs();
+
+    // 스크립트는 프롬프트, 기록 없이 줄만 꺼내 실행한다
+    if (!interactive)
     {
-        // 명령어, 옵션을 넘김
-        execvp(cmdTokens[0], cmdTokens);
+        text = readScriptLine();
+        if (text == NULL)
+            return 1;
+        // && || | 로 끝난 줄은 다음 줄과 합친다. 다음 줄을 읽으면 입력 버퍼가 옮겨질 수 있으므로 먼저 복사한다
+        while (lineContinues(text))
+        {
+            char *next;
+            size_t len = strlen(text);
+            char *head = arenaAlloc(&lineArena, len + 1);
 
-        // 실패 시 -1 반환 성공 시 무반환
-        perror("Command Error");
-        exit(1);
+            memcpy(head, text, len + 1);
+            next = readScriptLine();
+            if (next == NULL)
+            {
+                text = head; // 입력이 끝났으면 parseLine이 구문 오류로 알린다
+                break;
+            }
+            text = joinLines(head, len, next);
+        }
+        list = parseLine(text, &lineArena);
+        if (list == NULL)
+        {
+            // sh처럼 문법 오류가 난 스크립트는 더 실행하지 않고 상태 2로 끝낸다
+            lastStatus = 2;
+            return 1;
+        }
+        runList(list);
+        return exitShell;
     }
-    else
+
+    fputs("[mysh v0.1] $ ", stdout);
+    fflush(stdout);
+    waitForInput();
+
+    // 줄 길이에 제한이 없도록 getline으로 읽는다. 입력이 끝나면 (Ctrl-D) 종료
+    if (getline(&cmdLine, &lineCap, stdin) < 0)
     {
-        perror("Create Child Process Error");
+        fputc('\n', stdout);
+        return 1;
     }
 
-    return exitCode;
-}
-
-int cmd_cd(int argc, char *argv[])
-{
-    if (argc < 2)
+    // && || | 로 끝났으면 > 프롬프트로 다음 줄을 더 읽어 한 명령으로 합친다
+    while (lineContinues(cmdLine))
     {
-        char *home;
-        home = getenv("HOME");
+        static char *nextLine = NULL;
+        static size_t nextCap = 0;
+        size_t len = strlen(cmdLine);
 
-        // 홈 디렉터리가 없을 수 있나? 생각했지만 환경 변수를 수정했다면 충분히 가능
-        if (home == NULL)
+        fputs("> ", stdout);
+        fflush(stdout);
+        waitForInput();
+        if (getline(&nextLine, &nextCap, stdin) < 0)
         {
-            perror("NO HOME");
-            return 0;
+            fputc('\n', stdout);
+            break;
         }
-        // 환경 변수에 다른 home을 설정했다면 오류 발생 가능
-        if (chdir(home) != 0)
+        while (len > 0 && cmdLine[len - 1] == '\n')
+            len--;
+        text = joinLines(cmdLine, len, nextLine);
+        len = strlen(text);
+        if (len + 1 > lineCap)
         {
-            perror("cd");
-            return 0;
+            char *grown = realloc(cmdLine, len + 1);
+            if (grown == NULL)
+            {
+                perror("mysh");
+                break;
+            }
+            cmdLine = grown;
+            lineCap = len + 1;
         }
+        memcpy(cmdLine, text, len + 1);
     }
-    else if (argc == 2)
+    text = cmdLine;
+
+    // !! 등은 기록에 남기기 전에 바꾸고, 바뀐 명령을 보여 준다
+    if (strchr(cmdLine, '!'))
     {
-        if (argv[1][0] == '-')
+        refreshHistory();
+        long len = expandHistory(cmdLine, NULL);
+        if (len < 0)
         {
-            fprintf(stderr, "옵션 지원 안함\n");
-            return 0;
-        }
-        if (chdir(argv[1]) != 0)
-        {
-            perror("cd");
+            lastStatus = 1;
             return 0;
         }
+        text = arenaAlloc(&lineArena, len + 1);
+        expandHistory(cmdLine, text);
+        if (strcmp(text, cmdLine) != 0)
+            fputs(text, stdout);
     }
-    else
+    add_history(text);
+
+    list = parseLine(text, &lineArena);
+    if (list == NULL)
     {
-        fprintf(stderr, "cd: too many argumnets\n");
+        lastStatus = 2;
         return 0;
     }
+    runList(list);
+    return exitShell;
+}
+
+// data를 스크립트 입력으로 쓴다 (-c)
+void openCommandString(const char *cmd)
+{
+    input.data = strdup(cmd);
+    input.size = strlen(cmd);
+}
+
+// 정규 파일은 통째로 mmap 한다. 줄을 꺼내는 데 시스템 호출이 필요 없다
+// mmap은 페이지 경계에서 시작해야 하므로 파일 위치가 0일 때만 쓴다
+static int mapInput(int fd)
+{
+    struct stat st;
+    void *p;
 
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || lseek(fd, 0, SEEK_CUR) != 0)
+        return -1;
+    p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+        return -1;
+    input.data = p;
+    input.size = input.mapped = st.st_size;
     return 0;
 }
 
-int cmd_pwd(int argc, char *argv[])
+int openScript(const char *path)
 {
-    char buffer[STR_LEN];
-    if (getcwd(buffer, sizeof(buffer)) == NULL)
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
     {
-        // 현재 디렉터리에 권한이 없거나와 같은 오류
-        perror("pwd");
-        return 0;
+        fprintf(stderr, "mysh: %s: %s\n", path, strerror(errno));
+        return -1;
     }
-
-    if (argc >= 2)
+    if (mapInput(fd) == 0)
     {
-        if (argv[1][0] == '-')
-        {
-            // 2번째 인자로 옵션 오는 경우는 작동함
-            fprintf(stderr, "옵션 지원 안함\n");
-            return 0;
-        }
+        close(fd);
+        return 0;
     }
-
-    printf("%s\n", buffer);
+    input.fd = fd;
     return 0;
 }
 
-int cmd_exit(int argc, char *argvp[])
+// 터미널이 아닌 stdin. 파일이면 mmap 하고, 자식이 stdin을 이어 읽을 수 있게 줄마다 위치를 맞춘다
+void openStdinScript(void)
 {
-    return 1;
+    if (mapInput(STDIN_FILENO) == 0)
+        input.seekFd = STDIN_FILENO;
+    else
+        input.fd = STDIN_FILENO;
 }
 
-int cmd_help(int argc, char *argv[])
+// 블록 버퍼에 더 읽어 넣는다. 읽은 것이 없으면 0
+static ssize_t fillInput(void)
 {
-    if (argc == 1)
+    ssize_t n;
+
+    // 남은 조각을 앞으로 당기고, 버퍼가 가득 찼으면 (아주 긴 줄) 키운다
+    if (input.pos > 0)
     {
-        for (int i = 0; i < builtins; ++i)
-        {
+        memmove(input.data, input.data + input.pos, input.size - input.pos);
+        input.size -= input.pos;
+        input.pos = 0;
+    }
+    if (input.cap - input.size < INPUT_BLOCK / 2)
+    {
+        input.cap = input.cap ? input.cap * 2 : INPUT_BLOCK;
+        input.data = realloc(input.data, input.cap);
+        if (input.data == NULL)
+        {
+            perror("mysh");
+            exit(1);
+        }
+    }
+
+    do
+        n = read(input.fd, input.data + input.size, input.cap - input.size - 1);
+    while (n < 0 && errno == EINTR);
+    if (n > 0)
+        input.size += n;
+    return n > 0 ? n : 0;
+}
+
+// 다음 줄 (줄바꿈 자리에 NULL 문자를 쓴다). 입력이 끝나면 NULL
+char *readScriptLine(void)
+{
+    char *line;
+    char *nl;
+
+    // 앞 명령이 stdin을 읽었다면 (head 등) 그만큼 건너뛴다
+    if (input.seekFd >= 0)
+    {
+        off_t cur = lseek(input.seekFd, 0, SEEK_CUR);
+        if (cur > (off_t)input.pos && cur <= (off_t)input.size)
+            input.pos = cur;
+    }
+
+    for (;;)
+    {
+        nl = memchr(input.data + input.pos, '\n', input.size - input.pos);
+        if (nl || input.fd < 0 || fillInput() == 0)
+            break;
+    }
+    if (input.pos >= input.size)
+        return NULL;
+
+    line = input.data + input.pos;
+    if (nl)
+    {
+        *nl = '\0';
+        input.pos = nl - input.data + 1;
+    }
+    else
+    {
+        // 줄바꿈 없이 끝난 마지막 줄. mmap 끝에는 NULL 문자를 쓸 자리가 없을 수 있다
+        size_t len = input.size - input.pos;
+        if (input.mapped)
+        {
+            line = arenaAlloc(&lineArena, len + 1);
+            memcpy(line, input.data + input.pos, len);
+        }
+        line[len] = '\0';
+        input.pos = input.size;
+    }
+
+    if (input.seekFd >= 0)
+        lseek(input.seekFd, input.pos, SEEK_SET);
+    return line;
+}
+
+// clock_gettime은 시그널 핸들러에서도 쓸 수 있다
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 자식이 끝난 시각 (SIGCHLD를 받은 순간). 백그라운드 작업은 포그라운드 작업이 끝난 뒤에야
+// 회수되므로, 회수 시각 대신 이 값으로 run 구간을 끝낸다
+// 두 자식이 거의 함께 끝나 SIGCHLD가 하나로 합쳐지면 한쪽은 기록이 없으므로, 그때는 회수 시각을 쓴다
+#define EXIT_STAMPS 64
+
+typedef struct EXITSTAMP
+{
+    volatile pid_t pid;
+    volatile uint64_t ns;
+} EXITSTAMP;
+
+EXITSTAMP exitStamps[EXIT_STAMPS];
+volatile sig_atomic_t exitStampNext = 0;
+
+static void onSigchld(int sig, siginfo_t *info, void *ctx)
+{
+    int savedErrno = errno;
+
+    if (info->si_code == CLD_EXITED || info->si_code == CLD_KILLED || info->si_code == CLD_DUMPED)
+    {
+        EXITSTAMP *stamp = &exitStamps[exitStampNext];
+
+        exitStampNext = (exitStampNext + 1) % EXIT_STAMPS;
+        stamp->pid = 0;
+        stamp->ns = nowNs();
+        stamp->pid = info->si_pid;
+    }
+
+    // 실제 회수는 프롬프트 루프에서 한다 (파이프가 가득 차도 신호는 이미 전달된 것)
+    write(sigchldPipe[1], "c", 1);
+    errno = savedErrno;
+}
+
+// pid가 끝난 시각. 기록이 없거나 since보다 앞선 것(같은 pid를 쓴 예전 자식)이면 지금
+static uint64_t exitTime(pid_t pid, uint64_t since)
+{
+    for (int i = 0; i < EXIT_STAMPS; ++i)
+    {
+        if (exitStamps[i].pid == pid)
+        {
+            uint64_t ns = exitStamps[i].ns;
+
+            exitStamps[i].pid = 0;
+            if (ns >= since)
+                return ns;
+        }
+    }
+    return nowNs();
+}
+
+// 대화형이면 셸을 자기 프로세스 그룹에 두고 터미널을 가진다
+// 작업 제어 시그널은 셸이 아니라 포그라운드 작업에게만 가야 한다
+void initJobControl(void)
+{
+    struct sigaction sa;
+
+    if (pipe2(sigchldPipe, O_CLOEXEC | O_NONBLOCK) < 0)
+    {
+        perror("pipe");
+        exit(1);
+    }
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = onSigchld;
+    // 멈춘 자식도 알린다 (parallel이 ^Z를 알아채야 한다). siginfo로 끝난 pid와 시각을 남긴다
+    sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+
+    if (interactive)
+    {
+        signal(SIGINT, SIG_IGN);
+        signal(SIGQUIT, SIG_IGN);
+        signal(SIGTSTP, SIG_IGN);
+        signal(SIGTTIN, SIG_IGN);
+        setpgid(0, 0);
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+    }
+}
+
+// 입력을 기다리는 동안에도 SIGCHLD가 오면 바로 자식을 회수한다 (좀비가 쌓이지 않도록)
+// 알림 출력은 입력 중인 줄을 깨뜨리지 않도록 다음 프롬프트로 미룬다
+void waitForInput(void)
+{
+    struct pollfd pfd[2];
+
+    if (!interactive)
+        return;
+
+    pfd[0].fd = STDIN_FILENO;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = sigchldPipe[0];
+    pfd[1].events = POLLIN;
+    for (;;)
+    {
+        if (poll(pfd, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        if (pfd[1].revents)
+            reapJobs();
+        if (pfd[0].revents)
+            return;
+    }
+}
+
+static int statusToCode(int status)
+{
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    if (WIFSTOPPED(status))
+        return 128 + WSTOPSIG(status);
+    return 0;
+}
+
+static int jobIsRunning(const JOB *job)
+{
+    for (int i = 0; i < job->procNum; ++i)
+    {
+        if (job->state[i] == PROC_RUNNING)
+            return 1;
+    }
+    return 0;
+}
+
+static int jobIsStopped(const JOB *job)
+{
+    for (int i = 0; i < job->procNum; ++i)
+    {
+        if (job->state[i] == PROC_STOPPED)
+            return 1;
+    }
+    return 0;
+}
+
+static void freeJob(JOB *job)
+{
+    free(job->cmd);
+    memset(job, 0, sizeof(JOB));
+}
+
+static JOB *newJob(void)
+{
+    for (int i = 0; i < MAX_JOBS; ++i)
+    {
+        if (jobs[i].id == 0)
+        {
+            jobs[i].id = i + 1;
+            return &jobs[i];
+        }
+    }
+    return NULL;
+}
+
+// 계측: time 빌트인, 지연 히스토그램(stats), Chrome trace(Perfetto) 내보내기
+// 시점은 명령마다 항상 기록하고(vDSO clock_gettime이라 spawn 비용에 비해 무시할 만하다)
+// 히스토그램은 stats on 또는 MYSH_STATS가 있을 때만, trace는 파일이 열려 있을 때만 쌓는다
+#define HIST_BUCKETS 32
+
+// 칸 k는 [2^k, 2^(k+1)) us, 0번 칸은 2us 미만
+typedef struct HISTOGRAM
+{
+    const char *name;
+    uint64_t count[HIST_BUCKETS];
+    uint64_t num;
+    uint64_t total; // ns
+    uint64_t max;   // ns
+} HISTOGRAM;
+
+enum
+{
+    PHASE_SETUP,
+    PHASE_SPAWN,
+    PHASE_RUN,
+    PHASES
+};
+
+HISTOGRAM latency[PHASES] = {{.name = "setup"}, {.name = "spawn"}, {.name = "run"}};
+int statsEnabled = 0;
+FILE *traceFile = NULL;
+int traceEvents = 0;
+long childPeakRss = 0; // 회수한 자식의 최대 RSS (KB), time이 파이프라인마다 0으로 되돌린다
+
+static void histAdd(HISTOGRAM *h, uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    int k = us < 2 ? 0 : 63 - __builtin_clzll(us);
+
+    h->count[k < HIST_BUCKETS ? k : HIST_BUCKETS - 1]++;
+    h->num++;
+    h->total += ns;
+    if (ns > h->max)
+        h->max = ns;
+}
+
+// 사람이 읽기 좋은 단위로 (buf는 16바이트 이상)
+static const char *formatNs(char *buf, uint64_t ns)
+{
+    if (ns < 1000000)
+        sprintf(buf, "%.1fus", ns / 1e3);
+    else if (ns < 1000000000)
+        sprintf(buf, "%.2fms", ns / 1e6);
+    else
+        sprintf(buf, "%.2fs", ns / 1e9);
+    return buf;
+}
+
+static void writeJsonString(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (; *str; ++str)
+    {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// JSON Array 형식. 닫는 ]가 없어도 chrome://tracing과 Perfetto가 읽으므로 셸이 죽어도 쓸 수 있다
+static void traceBegin(void)
+{
+    fputs(traceEvents++ ? ",\n" : "[\n", traceFile);
+}
+
+// 완료 이벤트("ph":"X") 하나. ts와 dur은 us
+static void traceSlice(const char *name, const char *cat, pid_t tid, uint64_t start, uint64_t end)
+{
+    traceBegin();
+    fputs("{\"name\":", traceFile);
+    writeJsonString(traceFile, name);
+    fprintf(traceFile, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}", cat, start / 1e3,
+            (end - start) / 1e3, (int)getpid(), (int)tid);
+}
+
+// 셸이 실행한 파이프라인 하나 (셸 스레드에 그린다)
+static void tracePipeline(const char *cmd, uint64_t start, uint64_t end, int code)
+{
+    traceBegin();
+    fputs("{\"name\":", traceFile);
+    writeJsonString(traceFile, cmd);
+    fprintf(traceFile,
+            ",\"cat\":\"pipeline\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"status\":%d}}",
+            start / 1e3, (end - start) / 1e3, (int)getpid(), (int)getpid(), code);
+}
+
+// 자식 프로세스는 pid를 tid로 삼아 따로 줄을 만들고, 그 안에 setup/spawn/run 구간을 겹쳐 그린다
+static void traceProcess(const JOB *job, int i, uint64_t end, const struct rusage *ru)
+{
+    const SPAWNTIME *t = &job->times[i];
+    pid_t pid = job->pids[i];
+
+    traceBegin();
+    fprintf(traceFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", (int)getpid(),
+            (int)pid);
+    writeJsonString(traceFile, job->cmd);
+    fputs("}}", traceFile);
+
+    traceBegin();
+    fputs("{\"name\":", traceFile);
+    writeJsonString(traceFile, job->cmd);
+    fprintf(traceFile,
+            ",\"cat\":\"process\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"stage\":%d,"
+            "\"status\":%d,\"user_us\":%ld,\"sys_us\":%ld,\"maxrss_kb\":%ld,\"nvcsw\":%ld,\"nivcsw\":%ld}}",
+            t->start / 1e3, (end - t->start) / 1e3, (int)getpid(), (int)pid, i, statusToCode(job->status[i]),
+            ru->ru_utime.tv_sec * 1000000L + ru->ru_utime.tv_usec, ru->ru_stime.tv_sec * 1000000L + ru->ru_stime.tv_usec,
+            ru->ru_maxrss, ru->ru_nvcsw, ru->ru_nivcsw);
+    traceSlice("setup", "phase", pid, t->start, t->spawn);
+    traceSlice("spawn", "phase", pid, t->spawn, t->run);
+    traceSlice("run", "phase", pid, t->run, end);
+}
+
+// 외부 명령 하나가 끝났을 때 (markProcess에서)
+static void recordProcess(const JOB *job, int i, const struct rusage *ru)
+{
+    const SPAWNTIME *t = &job->times[i];
+    uint64_t end;
+
+    if (ru->ru_maxrss > childPeakRss)
+        childPeakRss = ru->ru_maxrss;
+    if (t->start == 0 || (!statsEnabled && traceFile == NULL))
+        return;
+
+    end = exitTime(job->pids[i], t->run);
+    if (statsEnabled)
+    {
+        histAdd(&latency[PHASE_SETUP], t->spawn - t->start);
+        histAdd(&latency[PHASE_SPAWN], t->run - t->spawn);
+        histAdd(&latency[PHASE_RUN], end - t->run);
+    }
+    if (traceFile)
+        traceProcess(job, i, end, ru);
+}
+
+static int openTrace(const char *path)
+{
+    FILE *file = fopen(path, "we");
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "mysh: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    closeTrace();
+    traceFile = file;
+    traceEvents = 0;
+    return 0;
+}
+
+void closeTrace(void)
+{
+    if (traceFile == NULL)
+        return;
+    fputs(traceEvents ? "\n]\n" : "[]\n", traceFile);
+    fclose(traceFile);
+    traceFile = NULL;
+}
+
+// MYSH_STATS가 있으면 히스토그램을 켜고, MYSH_TRACE=파일 이면 trace를 쓴다
+void initStats(void)
+{
+    const char *trace = getenv("MYSH_TRACE");
+
+    if (getenv("MYSH_STATS"))
+        statsEnabled = 1;
+    if (trace && *trace)
+        openTrace(trace);
+}
+
+// wait4 결과를 작업 테이블에 반영한다
+static void markProcess(pid_t pid, int status, const struct rusage *ru)
+{
+    for (int i = 0; i < MAX_JOBS; ++i)
+    {
+        for (int j = 0; jobs[i].id && j < jobs[i].procNum; ++j)
+        {
+            if (jobs[i].pids[j] != pid)
+                continue;
+            if (WIFSTOPPED(status))
+            {
+                jobs[i].state[j] = PROC_STOPPED;
+            }
+            else if (WIFCONTINUED(status))
+            {
+                jobs[i].state[j] = PROC_RUNNING;
+            }
+            else
+            {
+                jobs[i].state[j] = PROC_DONE;
+                jobs[i].status[j] = status;
+                recordProcess(&jobs[i], j, ru);
+            }
+            return;
+        }
+    }
+}
+
+// 파이프라인의 종료 상태는 마지막 단계의 상태
+static int jobStatus(const JOB *job)
+{
+    return statusToCode(job->status[job->procNum - 1]);
+}
+
+// 블로킹 없이 상태가 바뀐 자식을 모두 회수한다
+// waitpid(-1)을 쓰지 않고 작업 테이블에 있는 pid만 기다린다
+void reapJobs(void)
+{
+    char drain[64];
+    struct rusage ru;
+    int status;
+
+    while (read(sigchldPipe[0], drain, sizeof(drain)) > 0)
+        ;
+
+    for (int i = 0; i < MAX_JOBS; ++i)
+    {
+        for (int j = 0; jobs[i].id && j < jobs[i].procNum; ++j)
+        {
+            if (jobs[i].pids[j] <= 0 || jobs[i].state[j] == PROC_DONE)
+                continue;
+            if (wait4(jobs[i].pids[j], &status, WNOHANG | WUNTRACED | WCONTINUED, &ru) > 0)
+                markProcess(jobs[i].pids[j], status, &ru);
+        }
+    }
+}
+
+// 끝난 백그라운드 작업을 알리고 테이블에서 지운다
+void notifyJobs(void)
+{
+    for (int i = 0; i < MAX_JOBS; ++i)
+    {
+        if (jobs[i].id == 0 || jobIsRunning(&jobs[i]) || jobIsStopped(&jobs[i]))
+            continue;
+        if (interactive)
+        {
+            int code = jobStatus(&jobs[i]);
+            if (code == 0)
+                printf("[%d]+  Done                    %s\n", jobs[i].id, jobs[i].cmd);
+            else
+                printf("[%d]+  Exit %-18d %s\n", jobs[i].id, code, jobs[i].cmd);
+        }
+        freeJob(&jobs[i]);
+    }
+}
+
+// 포그라운드 작업이 끝나거나 멈출 때까지 기다린다. 종료 상태를 반환
+int waitForJob(JOB *job)
+{
+    struct rusage ru;
+    int status;
+    int code;
+
+    if (interactive)
+        tcsetpgrp(STDIN_FILENO, job->pgid);
+
+    // 스크립트에서는 자식이 셸의 프로세스 그룹에 있으므로 pid 별로 기다린다
+    for (int i = 0; i < job->procNum; ++i)
+    {
+        while (job->state[i] == PROC_RUNNING)
+        {
+            if (wait4(job->pids[i], &status, WUNTRACED, &ru) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                job->state[i] = PROC_DONE;
+                break;
+            }
+            markProcess(job->pids[i], status, &ru);
+        }
+    }
+
+    // 터미널을 셸에게 되돌린다
+    if (interactive)
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+
+    if (jobIsStopped(job))
+    {
+        job->background = 1;
+        printf("\n[%d]+  Stopped                 %s\n", job->id, job->cmd);
+        return 128 + SIGTSTP;
+    }
+
+    code = jobStatus(job);
+    freeJob(job);
+    return code;
+}
+
+int findBuiltin(const char *name)
+{
+    for (int i = 0; i < builtins; ++i)
+    {
+        if (strcmp(name, builtin[i].name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void *arenaAlloc(ARENA *arena, size_t size)
+{
+    ARENABLOCK *block = arena->head;
+    void *p;
+
+    size = (size + 7) & ~(size_t)7;
+    if (block == NULL || block->cap - block->used < size)
+    {
+        size_t cap = size > ARENA_BLOCK ? size : ARENA_BLOCK;
+        block = malloc(sizeof(ARENABLOCK) + cap);
+        if (block == NULL)
+        {
+            perror("mysh");
+            exit(1);
+        }
+        block->next = arena->head;
+        block->cap = cap;
+        block->used = 0;
+        arena->head = block;
+    }
+    p = block->data + block->used;
+    block->used += size;
+    return p;
+}
+
+// 블록이 여러 개 생겼었다면 합친 크기의 블록 하나로 바꿔, 다음부터는 한 블록에서 끝나게 한다
+void arenaReset(ARENA *arena)
+{
+    ARENABLOCK *block = arena->head;
+    size_t total = 0;
+
+    if (block == NULL)
+        return;
+    if (block->next == NULL)
+    {
+        block->used = 0;
+        return;
+    }
+    while (block)
+    {
+        ARENABLOCK *next = block->next;
+        total += block->cap;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arenaAlloc(arena, total);
+    arena->head->used = 0;
+}
+
+static void vecPush(ARENA *arena, VEC *vec, void *item)
+{
+    if (vec->num + 1 >= vec->cap)
+    {
+        int cap = vec->cap ? vec->cap * 2 : 8;
+        void **items = arenaAlloc(arena, cap * sizeof(void *));
+        if (vec->num)
+            memcpy(items, vec->items, vec->num * sizeof(void *));
+        vec->items = items;
+        vec->cap = cap;
+    }
+    vec->items[vec->num++] = item;
+    vec->items[vec->num] = NULL;
+}
+
+enum
+{
+    TOK_END,
+    TOK_WORD,
+    TOK_PIPE, // |
+    TOK_OR,   // ||
+    TOK_AMP,  // &
+    TOK_AND,  // &&
+    TOK_SEMI, // ;
+    TOK_NEWLINE,
+    TOK_REDIR
+};
+
+#define WORD_GLOB 1   // 따옴표 밖에 * ? [ 가 있음 (단어는 glob 패턴 형태로 남긴다)
+#define WORD_EXPAND 2 // $?가 있음 (실행할 때 바꾼다)
+
+// 단어 안의 $? 자리 표시. 앞 명령이 끝나야 값을 알 수 있으므로 파싱할 때는 표시만 해 둔다
+#define STATUS_MARK '\001'
+
+// glob 패턴에서 \ 로 이스케이프되는 문자
+#define GLOB_SPECIAL "*?[]\\"
+
+typedef struct TOKEN
+{
+    int type;
+    char *word;
+    int flags;
+    int fd;    // TOK_REDIR
+    int redir; // REDIR_*
+    int dupFd;
+} TOKEN;
+
+// 단어는 가능하면 입력 버퍼를 그대로 가리킨다 (단어 끝에 NULL 문자를 써 넣음)
+// 그 자리에 있던 문자는 saved에 두고 다음 토큰을 읽을 때 쓴다
+typedef struct LEXER
+{
+    char *p;
+    char saved;
+    int hasSaved;
+    ARENA *arena;
+} LEXER;
+
+static char lexPeek(LEXER *lx, int i)
+{
+    return (i == 0 && lx->hasSaved) ? lx->saved : lx->p[i];
+}
+
+static void lexSkip(LEXER *lx, int n)
+{
+    lx->p += n;
+    lx->hasSaved = 0;
+}
+
+// <, >, >>, >&m, <&m (fd는 앞에 붙은 숫자 또는 기본값)
+static int lexRedirect(LEXER *lx, TOKEN *tok, int fd)
+{
+    char c = lexPeek(lx, 0);
+
+    tok->type = TOK_REDIR;
+    tok->fd = fd;
+    lexSkip(lx, 1);
+    if (c == '>' && lexPeek(lx, 0) == '>')
+    {
+        tok->redir = REDIR_APPEND;
+        lexSkip(lx, 1);
+    }
+    else if (lexPeek(lx, 0) == '&')
+    {
+        lexSkip(lx, 1);
+        if (!isdigit((unsigned char)lexPeek(lx, 0)))
+        {
+            fprintf(stderr, "mysh: syntax error near `%c&'\n", c);
+            return -1;
+        }
+        tok->redir = REDIR_DUP;
+        tok->dupFd = lexPeek(lx, 0) - '0';
+        lexSkip(lx, 1);
+    }
+    else
+    {
+        tok->redir = c == '<' ? REDIR_IN : REDIR_OUT;
+    }
+    return 0;
+}
+
+// glob 패턴 단어에서 따옴표 안이나 \ 뒤에 있던 특수 문자는 \ 를 붙여 글자 그대로임을 남긴다
+static char *putLiteral(char *out, char c, int glob)
+{
+    if (glob && strchr(GLOB_SPECIAL, c))
+        *out++ = '\\';
+    *out++ = c;
+    return out;
+}
+
+// 따옴표와 \ 를 푼 단어를 아레나에 만든다. $?는 STATUS_MARK 한 글자로 바꿔 둔다
+// glob이면 패턴으로 쓸 수 있도록 따옴표로 막힌 특수 문자를 \ 로 이스케이프한다
+static char *unquoteWord(ARENA *arena, const char *start, const char *end, int glob)
+{
+    char *word = arenaAlloc(arena, (end - start) * (glob ? 2 : 1) + 1);
+    char *out = word;
+    int squote = 0;
+    int dquote = 0;
+
+    for (const char *p = start; p < end; ++p)
+    {
+        if (squote)
+        {
+            if (*p == '\'')
+                squote = 0;
+            else
+                out = putLiteral(out, *p, glob);
+        }
+        else if (*p == '\\' && p + 1 < end)
+        {
+            // 큰따옴표 안에서는 " \ $ ` 앞의 \ 만 특별하다
+            if (dquote && !strchr("\"\\$`", p[1]))
+                out = putLiteral(out, *p, glob);
+            ++p;
+            out = putLiteral(out, *p, glob);
+        }
+        else if (*p == '\'' && !dquote)
+        {
+            squote = 1;
+        }
+        else if (*p == '"')
+        {
+            dquote = !dquote;
+        }
+        else if (*p == '$' && p + 1 < end && p[1] == '?')
+        {
+            *out++ = STATUS_MARK;
+            p++;
+        }
+        else
+        {
+            out = putLiteral(out, *p, glob && dquote);
+        }
+    }
+    *out = '\0';
+    return word;
+}
+
+// 패턴의 \ 이스케이프를 푼 글자 그대로의 단어 (이스케이프가 없으면 그대로 돌려준다)
+static char *unescapeGlob(ARENA *arena, char *pattern)
+{
+    char *word;
+    char *out;
+
+    if (strchr(pattern, '\\') == NULL)
+        return pattern;
+    word = out = arenaAlloc(arena, strlen(pattern) + 1);
+    for (const char *p = pattern; *p; ++p)
+    {
+        if (*p == '\\' && p[1])
+            ++p;
+        *out++ = *p;
+    }
+    *out = '\0';
+    return word;
+}
+
+static int lexWord(LEXER *lx, TOKEN *tok)
+{
+    char *start = lx->p;
+    char *q;
+    int spill = 0;
+    int squote = 0;
+    int dquote = 0;
+
+    for (q = start; *q; ++q)
+    {
+        if (squote)
+        {
+            squote = *q != '\'';
+            continue;
+        }
+        if (*q == '\\')
+        {
+            spill = 1;
+            if (q[1])
+                ++q;
+        }
+        else if (*q == '$' && q[1] == '?')
+        {
+            spill = 1;
+            tok->flags |= WORD_EXPAND;
+        }
+        else if (dquote)
+        {
+            dquote = *q != '"';
+        }
+        else if (*q == '\'' || *q == '"')
+        {
+            squote = *q == '\'';
+            dquote = *q == '"';
+            spill = 1;
+        }
+        else if (strchr(" \t\r\n|&;<>", *q))
+        {
+            break;
+        }
+        else if (strchr("*?[", *q))
+        {
+            tok->flags |= WORD_GLOB;
+        }
+    }
+    if (squote || dquote)
+    {
+        fprintf(stderr, "mysh: unexpected EOF while looking for matching `%c'\n", squote ? '\'' : '"');
+        return -1;
+    }
+
+    // 2> 처럼 숫자 하나 바로 뒤에 < > 가 오면 리다이렉션
+    if (q - start == 1 && isdigit((unsigned char)*start) && (*q == '<' || *q == '>'))
+    {
+        lexSkip(lx, 1);
+        return lexRedirect(lx, tok, *start - '0');
+    }
+
+    tok->type = TOK_WORD;
+    if (spill)
+    {
+        tok->word = unquoteWord(lx->arena, start, q, tok->flags & WORD_GLOB);
+        lx->p = q;
+        lx->hasSaved = 0;
+        return 0;
+    }
+
+    // 풀 것이 없는 단어는 복사하지 않는다
+    tok->word = start;
+    lx->p = q;
+    lx->saved = *q;
+    lx->hasSaved = 1;
+    *q = '\0';
+    return 0;
+}
+
+// 다음 토큰. 오류면 -1
+static int lexToken(LEXER *lx, TOKEN *tok)
+{
+    char c;
+
+    memset(tok, 0, sizeof(TOKEN));
+    for (;;)
+    {
+        c = lexPeek(lx, 0);
+        if (c == ' ' || c == '\t' || c == '\r')
+        {
+            lexSkip(lx, 1);
+        }
+        else if (c == '#')
+        {
+            // 주석은 줄 끝까지
+            while (lexPeek(lx, 0) && lexPeek(lx, 0) != '\n')
+                lexSkip(lx, 1);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    switch (c)
+    {
+    case '\0':
+        tok->type = TOK_END;
+        return 0;
+    case '\n':
+    case ';':
+        tok->type = c == ';' ? TOK_SEMI : TOK_NEWLINE;
+        lexSkip(lx, 1);
+        return 0;
+    case '|':
+        tok->type = lexPeek(lx, 1) == '|' ? TOK_OR : TOK_PIPE;
+        lexSkip(lx, tok->type == TOK_OR ? 2 : 1);
+        return 0;
+    case '&':
+        tok->type = lexPeek(lx, 1) == '&' ? TOK_AND : TOK_AMP;
+        lexSkip(lx, tok->type == TOK_AND ? 2 : 1);
+        return 0;
+    case '<':
+    case '>':
+        return lexRedirect(lx, tok, c == '<' ? 0 : 1);
+    }
+    return lexWord(lx, tok);
+}
+
+typedef struct PARSER
+{
+    LEXER lx;
+    TOKEN tok; // 다음에 처리할 토큰
+    ARENA *arena;
+} PARSER;
+
+static int parseNext(PARSER *ps)
+{
+    return lexToken(&ps->lx, &ps->tok);
+}
+
+static void syntaxError(const TOKEN *tok)
+{
+    static const char *names[] = {"newline", "word", "|", "||", "&", "&&", ";", "newline", "redirection"};
+
+    fprintf(stderr, "mysh: syntax error near unexpected token `%s'\n", names[tok->type]);
+}
+
+// 단어와 리다이렉션의 나열
+static STAGE *parseStage(PARSER *ps)
+{
+    STAGE *stage = arenaAlloc(ps->arena, sizeof(STAGE));
+    REDIR **tail = &stage->redirs;
+    VEC argv = {NULL, 0, 0};
+    VEC globs = {NULL, 0, 0};
+    int hasGlob = 0;
+
+    stage->redirs = NULL;
+    stage->expand = 0;
+    for (;;)
+    {
+        stage->expand |= ps->tok.flags & WORD_EXPAND;
+        if (ps->tok.type == TOK_WORD)
+        {
+            vecPush(ps->arena, &argv, ps->tok.word);
+            vecPush(ps->arena, &globs, ps->tok.flags & WORD_GLOB ? ps->tok.word : NULL);
+            hasGlob |= ps->tok.flags & WORD_GLOB;
+        }
+        else if (ps->tok.type == TOK_REDIR)
+        {
+            REDIR *redir = arenaAlloc(ps->arena, sizeof(REDIR));
+
+            redir->fd = ps->tok.fd;
+            redir->type = ps->tok.redir;
+            redir->dupFd = ps->tok.dupFd;
+            redir->target = NULL;
+            redir->next = NULL;
+            if (redir->fd > 2 || (redir->type == REDIR_DUP && redir->dupFd > 2))
+            {
+                fprintf(stderr, "mysh: %d: bad file descriptor\n", redir->fd > 2 ? redir->fd : redir->dupFd);
+                return NULL;
+            }
+            if (redir->type != REDIR_DUP)
+            {
+                if (parseNext(ps) < 0)
+                    return NULL;
+                if (ps->tok.type != TOK_WORD)
+                {
+                    syntaxError(&ps->tok);
+                    return NULL;
+                }
+                stage->expand |= ps->tok.flags & WORD_EXPAND;
+                // 리다이렉션 대상은 glob 확장하지 않는다 (이스케이프만 푼다)
+                redir->target = ps->tok.flags & WORD_GLOB ? unescapeGlob(ps->arena, ps->tok.word) : ps->tok.word;
+            }
+            *tail = redir;
+            tail = &redir->next;
+        }
+        else
+        {
+            break;
+        }
+        if (parseNext(ps) < 0)
+            return NULL;
+    }
+
+    if (argv.num == 0)
+    {
+        syntaxError(&ps->tok);
+        return NULL;
+    }
+    stage->argv = (char **)argv.items;
+    stage->argc = argv.num;
+    stage->globs = hasGlob ? (char **)globs.items : NULL;
+    return stage;
+}
+
+// stage ( | stage )*
+static PIPELINE *parsePipeline(PARSER *ps)
+{
+    PIPELINE *pl = arenaAlloc(ps->arena, sizeof(PIPELINE));
+    VEC stages = {NULL, 0, 0};
+
+    for (;;)
+    {
+        STAGE *stage = parseStage(ps);
+        if (stage == NULL)
+            return NULL;
+        vecPush(ps->arena, &stages, stage);
+        if (ps->tok.type != TOK_PIPE)
+            break;
+        if (stages.num >= MAX_STAGES)
+        {
+            fprintf(stderr, "mysh: too many pipeline stages (max %d)\n", MAX_STAGES);
+            return NULL;
+        }
+        if (parseNext(ps) < 0)
+            return NULL;
+    }
+
+    pl->stages = (STAGE **)stages.items;
+    pl->stageNum = stages.num;
+    pl->op = OP_SEQ;
+    pl->background = 0;
+    return pl;
+}
+
+// 한 줄을 구문 트리로 만든다. 문법 오류면 NULL
+// list := pipeline ( (&& | ||) pipeline )* ( ; | & ) ...
+CMDLIST *parseLine(char *line, ARENA *arena)
+{
+    CMDLIST *list = arenaAlloc(arena, sizeof(CMDLIST));
+    VEC pipes = {NULL, 0, 0};
+    PARSER ps;
+    int op = OP_SEQ;
+    int groupStart = 0;
+
+    ps.lx.p = line;
+    ps.lx.hasSaved = 0;
+    ps.lx.arena = arena;
+    ps.arena = arena;
+    if (parseNext(&ps) < 0)
+        return NULL;
+
+    while (ps.tok.type != TOK_END)
+    {
+        PIPELINE *pl;
+
+        // 빈 줄은 건너뛴다 (&& || | 로 끝난 줄은 cmdProcessing이 다음 줄과 합쳐서 넘긴다)
+        // 명령 없이 나온 ; 는 parsePipeline이 구문 오류로 알린다 (";;", "; echo")
+        if (ps.tok.type == TOK_NEWLINE)
+        {
+            if (parseNext(&ps) < 0)
+                return NULL;
+            continue;
+        }
+
+        pl = parsePipeline(&ps);
+        if (pl == NULL)
+            return NULL;
+        pl->op = op;
+        vecPush(arena, &pipes, pl);
+
+        switch (ps.tok.type)
+        {
+        case TOK_AND:
+        case TOK_OR:
+            op = ps.tok.type == TOK_AND ? OP_AND : OP_OR;
+            if (parseNext(&ps) < 0)
+                return NULL;
+            continue;
+        case TOK_AMP:
+            // 셸을 복제하지 않으므로 && || 로 묶인 여러 파이프라인은 백그라운드로 돌릴 수 없다
+            if (pipes.num - groupStart > 1)
+            {
+                fprintf(stderr, "mysh: background and-or lists are not supported\n");
+                return NULL;
+            }
+            pl->background = 1;
+            // fall through
+        case TOK_SEMI:
+        case TOK_NEWLINE:
+            if (parseNext(&ps) < 0)
+                return NULL;
+            break;
+        case TOK_END:
+            break;
+        default:
+            syntaxError(&ps.tok);
+            return NULL;
+        }
+        op = OP_SEQ;
+        groupStart = pipes.num;
+    }
+
+    // && 나 || 로 끝난 줄
+    if (op != OP_SEQ)
+    {
+        syntaxError(&ps.tok);
+        return NULL;
+    }
+
+    list->pipes = (PIPELINE **)pipes.items;
+    list->pipeNum = pipes.num;
+    return list;
+}
+
+// 작업 목록에 보여 줄 명령 문자열 (호출한 쪽이 free)
+static char *pipelineText(const PIPELINE *pl)
+{
+    static const char *ops[] = {"<", ">", ">>", ">&"};
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+
+    for (int i = 0; i < pl->stageNum; ++i)
+    {
+        const STAGE *stage = pl->stages[i];
+
+        if (i > 0)
+            fputs(" | ", out);
+        for (int j = 0; j < stage->argc; ++j)
+            fprintf(out, j ? " %s" : "%s", stage->argv[j]);
+        for (const REDIR *r = stage->redirs; r; r = r->next)
+        {
+            if (r->fd != (r->type == REDIR_IN ? 0 : 1))
+                fprintf(out, " %d%s", r->fd, ops[r->type]);
+            else
+                fprintf(out, " %s", ops[r->type]);
+            if (r->type == REDIR_DUP)
+                fprintf(out, "%d", r->dupFd);
+            else
+                fputs(r->target, out);
+        }
+    }
+    fclose(out);
+    return text;
+}
+
+// 경로 이름 확장 (glob)
+// 디렉터리는 getdents64로 한 번에 읽고 d_type을 쓰므로 항목마다 stat 하지 않는다
+// 읽은 디렉터리는 이번 줄이 끝날 때까지 캐시하므로(lineArena) 같은 디렉터리를 쓰는 패턴이 여러 개여도 한 번만 읽는다
+// 패턴은 fnmatch 대신 미리 컴파일한 연산 배열로 맞추고, 고정된 앞/뒤 글자와 길이로 먼저 거른다
+// 정렬은 디렉터리 전체가 아니라 맞은 항목만 한다 (수십만 개 중 몇 개만 맞는 경우가 흔하다)
+#define GLOB_BUF (128 * 1024)
+
+enum
+{
+    GLOB_CHAR,
+    GLOB_ANY,   // ?
+    GLOB_STAR,  // *
+    GLOB_CLASS, // [...]
+};
+
+typedef struct GLOBOP
+{
+    unsigned char type;
+    unsigned char c;          // GLOB_CHAR
+    const unsigned char *set; // GLOB_CLASS, 256비트
+} GLOBOP;
+
+// 경로의 한 부분 ('/' 사이)
+typedef struct GLOBPAT
+{
+    GLOBOP *ops;
+    int opNum;
+    char *literal; // 특수 문자가 없으면 이스케이프를 푼 이름, 있으면 NULL
+    int prefixLen; // 처음 * 앞의 GLOB_CHAR 수
+    int suffixLen; // 마지막 * 뒤의 GLOB_CHAR 수 (* 가 없으면 0)
+    int minLen;
+    int hasStar;
+    int dotOk; // . 으로 시작하는 패턴만 숨김 파일을 고른다
+} GLOBPAT;
+
+typedef struct GLOBENT
+{
+    const char *name;
+    unsigned int len;
+    unsigned char type; // DT_*
+} GLOBENT;
+
+// 이번 줄에서 읽은 디렉터리. mtime이 바뀌었으면(앞 명령이 파일을 만들거나 지움) 다시 읽는다
+typedef struct GLOBDIR
+{
+    struct GLOBDIR *next;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    GLOBENT *ents;
+    int num;
+} GLOBDIR;
+
+// getdents64가 채우는 레코드
+typedef struct LINUXDIRENT
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} LINUXDIRENT;
+
+GLOBDIR *globDirs = NULL;
+
+void resetGlobCache(void)
+{
+    globDirs = NULL;
+}
+
+static const struct
+{
+    const char *name;
+    int (*is)(int);
+} globClasses[] = {{"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum}, {"upper", isupper},
+                   {"lower", islower}, {"space", isspace}, {"punct", ispunct}, {"xdigit", isxdigit}};
+
+// [ 다음부터 읽어 집합을 만든다. 닫는 ]가 없으면 NULL (그 [ 는 글자 그대로)
+static const char *compileClass(const char *p, unsigned char *set)
+{
+    int negate = 0;
+    int first = 1;
+
+    memset(set, 0, 32);
+    if (*p == '!' || *p == '^')
+    {
+        negate = 1;
+        ++p;
+    }
+    for (; *p && (*p != ']' || first); first = 0)
+    {
+        unsigned char lo, hi;
+
+        if (p[0] == '[' && p[1] == ':')
+        {
+            const char *end = strstr(p + 2, ":]");
+            int found = 0;
+            for (size_t k = 0; end && k < sizeof(globClasses) / sizeof(globClasses[0]); ++k)
+            {
+                if ((size_t)(end - p - 2) == strlen(globClasses[k].name) &&
+                    !strncmp(p + 2, globClasses[k].name, end - p - 2))
+                {
+                    for (int c = 1; c < 256; ++c)
+                        if (globClasses[k].is(c))
+                            set[c >> 3] |= 1 << (c & 7);
+                    found = 1;
+                }
+            }
+            if (found)
+            {
+                p = end + 2;
+                continue;
+            }
+        }
+        if (*p == '\\' && p[1])
+            ++p;
+        lo = hi = *p++;
+        if (p[0] == '-' && p[1] && p[1] != ']')
+        {
+            ++p;
+            if (*p == '\\' && p[1])
+                ++p;
+            hi = *p++;
+        }
+        for (int c = lo; c <= hi; ++c)
+            set[c >> 3] |= 1 << (c & 7);
+    }
+    if (*p != ']')
+        return NULL;
+    if (negate)
+    {
+        for (int k = 0; k < 32; ++k)
+            set[k] = ~set[k];
+    }
+    set[0] &= ~1; // NULL 문자는 어디에도 없다
+    return p + 1;
+}
+
+// pattern[0..len) 한 부분을 컴파일한다
+static void compileGlob(GLOBPAT *pat, const char *pattern, size_t len)
+{
+    char *seg = arenaAlloc(&lineArena, len + 1);
+    int lastStar = -1;
+
+    memcpy(seg, pattern, len);
+    seg[len] = '\0';
+    pat->ops = arenaAlloc(&lineArena, (len + 1) * sizeof(GLOBOP));
+    pat->opNum = 0;
+    pat->hasStar = 0;
+    pat->minLen = 0;
+    pat->literal = NULL;
+    pat->dotOk = seg[0] == '.';
+
+    for (const char *p = seg; *p;)
+    {
+        GLOBOP *op = &pat->ops[pat->opNum++];
+
+        op->set = NULL;
+        if (*p == '*')
+        {
+            // ** 는 * 하나와 같다
+            while (*p == '*')
+                ++p;
+            op->type = GLOB_STAR;
+            pat->hasStar = 1;
+            lastStar = pat->opNum - 1;
+            continue;
+        }
+        pat->minLen++;
+        if (*p == '?')
+        {
+            op->type = GLOB_ANY;
+            ++p;
+        }
+        else if (*p == '[')
+        {
+            unsigned char *set = arenaAlloc(&lineArena, 32);
+            const char *next = compileClass(p + 1, set);
+            if (next)
+            {
+                op->type = GLOB_CLASS;
+                op->set = set;
+                p = next;
+            }
+            else
+            {
+                op->type = GLOB_CHAR;
+                op->c = *p++;
+            }
+        }
+        else
+        {
+            if (*p == '\\' && p[1])
+                ++p;
+            op->type = GLOB_CHAR;
+            op->c = *p++;
+        }
+    }
+
+    pat->prefixLen = 0;
+    while (pat->prefixLen < pat->opNum && pat->ops[pat->prefixLen].type == GLOB_CHAR)
+        pat->prefixLen++;
+    pat->suffixLen = 0;
+    if (pat->hasStar)
+    {
+        while (pat->opNum - 1 - pat->suffixLen > lastStar && pat->ops[pat->opNum - 1 - pat->suffixLen].type == GLOB_CHAR)
+            pat->suffixLen++;
+    }
+    if (pat->prefixLen == pat->opNum)
+        pat->literal = unescapeGlob(&lineArena, seg);
+}
+
+// ops를 s[0..len)에 맞춘다. * 는 마지막 * 에서만 되돌아가면 충분하다 (선형에 가깝다)
+static int matchOps(const GLOBOP *ops, int opNum, const char *s, size_t len)
+{
+    int pi = 0;
+    size_t si = 0;
+    int starPi = -1;
+    size_t starSi = 0;
+
+    while (si < len)
+    {
+        if (pi < opNum)
+        {
+            const GLOBOP *op = &ops[pi];
+            unsigned char c = s[si];
+
+            if (op->type == GLOB_STAR)
+            {
+                starPi = ++pi;
+                starSi = si;
+                continue;
+            }
+            if (op->type == GLOB_ANY || (op->type == GLOB_CHAR && op->c == c) ||
+                (op->type == GLOB_CLASS && (op->set[c >> 3] >> (c & 7) & 1)))
+            {
+                pi++;
+                si++;
+                continue;
+            }
+        }
+        if (starPi < 0)
+            return 0;
+        pi = starPi;
+        si = ++starSi;
+    }
+    while (pi < opNum && ops[pi].type == GLOB_STAR)
+        pi++;
+    return pi == opNum;
+}
+
+static int matchGlob(const GLOBPAT *pat, const GLOBENT *ent)
+{
+    const char *name = ent->name;
+    size_t len = ent->len;
+
+    if (len < (size_t)pat->minLen || (!pat->hasStar && len != (size_t)pat->minLen))
+        return 0;
+    if (name[0] == '.' && !pat->dotOk)
+        return 0;
+    for (int i = 0; i < pat->prefixLen; ++i)
+    {
+        if ((unsigned char)name[i] != pat->ops[i].c)
+            return 0;
+    }
+    for (int i = 0; i < pat->suffixLen; ++i)
+    {
+        if ((unsigned char)name[len - pat->suffixLen + i] != pat->ops[pat->opNum - pat->suffixLen + i].c)
+            return 0;
+    }
+    return matchOps(pat->ops + pat->prefixLen, pat->opNum - pat->prefixLen - pat->suffixLen, name + pat->prefixLen,
+                    len - pat->prefixLen - pat->suffixLen);
+}
+
+// 디렉터리를 읽어(또는 캐시에서) 항목을 돌려준다 (읽은 순서 그대로, . 과 .. 는 뺀다)
+static GLOBDIR *scanDir(const char *path)
+{
+    static char *buf = NULL;           // getdents64 버퍼
+    static GLOBENT *ents = NULL;       // 읽는 동안 쓰는 항목 (이름은 names 안의 위치)
+    static char *names = NULL;
+    static size_t entCap = 0, nameCap = 0;
+    size_t num = 0, nameLen = 0;
+    struct stat st;
+    GLOBDIR *dir;
+    long n;
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    for (dir = globDirs; dir; dir = dir->next)
+    {
+        if (dir->dev == st.st_dev && dir->ino == st.st_ino && dir->mtime.tv_sec == st.st_mtim.tv_sec &&
+            dir->mtime.tv_nsec == st.st_mtim.tv_nsec)
+        {
+            close(fd);
+            return dir;
+        }
+    }
+
+    if (buf == NULL)
+        buf = malloc(GLOB_BUF);
+    while ((n = syscall(SYS_getdents64, fd, buf, GLOB_BUF)) > 0)
+    {
+        for (long off = 0; off < n;)
+        {
+            LINUXDIRENT *d = (LINUXDIRENT *)(buf + off);
+            size_t len = strlen(d->d_name);
+
+            off += d->d_reclen;
+            if (d->d_name[0] == '.' && (len == 1 || (len == 2 && d->d_name[1] == '.')))
+                continue;
+            if (num == entCap)
+            {
+                entCap = entCap ? entCap * 2 : 1024;
+                ents = realloc(ents, entCap * sizeof(GLOBENT));
+            }
+            if (nameLen + len + 1 > nameCap)
+            {
+                nameCap = nameCap ? nameCap * 2 : 64 * 1024;
+                while (nameLen + len + 1 > nameCap)
+                    nameCap *= 2;
+                names = realloc(names, nameCap);
+            }
+            memcpy(names + nameLen, d->d_name, len + 1);
+            ents[num].name = (const char *)(uintptr_t)nameLen;
+            ents[num].len = len;
+            ents[num].type = d->d_type;
+            num++;
+            nameLen += len + 1;
+        }
+    }
+    close(fd);
+    if (n < 0)
+        return NULL;
+
+    // 크기를 알았으니 아레나에 한 번에 옮긴다
+    dir = arenaAlloc(&lineArena, sizeof(GLOBDIR));
+    dir->ents = arenaAlloc(&lineArena, num * sizeof(GLOBENT) + 1);
+    dir->num = num;
+    dir->dev = st.st_dev;
+    dir->ino = st.st_ino;
+    dir->mtime = st.st_mtim;
+    if (num)
+    {
+        char *copy = arenaAlloc(&lineArena, nameLen);
+        memcpy(copy, names, nameLen);
+        for (size_t i = 0; i < num; ++i)
+        {
+            dir->ents[i] = ents[i];
+            dir->ents[i].name = copy + (uintptr_t)ents[i].name;
+        }
+    }
+    dir->next = globDirs;
+    globDirs = dir;
+    return dir;
+}
+
+static int compareEntries(const void *a, const void *b)
+{
+    return strcmp((*(const GLOBENT **)a)->name, (*(const GLOBENT **)b)->name);
+}
+
+// 디렉터리 이름은 뒤에 '/'가 붙은 것처럼 비교해야 전체 경로의 순서와 같아진다 ("a-b/x" < "a/x")
+static int compareDirEntries(const void *a, const void *b)
+{
+    const unsigned char *x = (const unsigned char *)(*(const GLOBENT **)a)->name;
+    const unsigned char *y = (const unsigned char *)(*(const GLOBENT **)b)->name;
+
+    while (*x && *x == *y)
+        ++x, ++y;
+    return (*x ? *x : '/') - (*y ? *y : '/');
+}
+
+static int isDirEntry(const GLOBENT *ent, const char *path)
+{
+    struct stat st;
+
+    if (ent->type == DT_DIR)
+        return 1;
+    if (ent->type != DT_LNK && ent->type != DT_UNKNOWN)
+        return 0;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+typedef struct GLOBCTX
+{
+    GLOBPAT *segs;
+    int segNum;
+    int dirOnly; // 패턴이 / 로 끝남
+    VEC *out;
+    int found;
+    char path[PATH_MAX];
+} GLOBCTX;
+
+static void pushMatch(GLOBCTX *ctx, size_t len)
+{
+    char *word = arenaAlloc(&lineArena, len + 2);
+
+    memcpy(word, ctx->path, len);
+    if (ctx->dirOnly)
+        word[len++] = '/';
+    word[len] = '\0';
+    vecPush(&lineArena, ctx->out, word);
+    ctx->found++;
+}
+
+// path[0..len)은 지금까지 맞춘 디렉터리 ("" 또는 '/'로 끝남)
+static void globWalk(GLOBCTX *ctx, size_t len, int seg)
+{
+    const GLOBPAT *pat = &ctx->segs[seg];
+    int last = seg == ctx->segNum - 1;
+    int wantDir = !last || ctx->dirOnly;
+    const GLOBENT **matches;
+    int matchNum = 0;
+    GLOBDIR *dir;
+
+    if (pat->literal)
+    {
+        size_t litLen = strlen(pat->literal);
+        struct stat st;
+
+        if (len + litLen + 2 > sizeof(ctx->path))
+            return;
+        memcpy(ctx->path + len, pat->literal, litLen);
+        len += litLen;
+        ctx->path[len] = '\0';
+        if (last)
+        {
+            if (ctx->dirOnly ? stat(ctx->path, &st) == 0 && S_ISDIR(st.st_mode) : lstat(ctx->path, &st) == 0)
+                pushMatch(ctx, len);
+            return;
+        }
+        ctx->path[len++] = '/';
+        globWalk(ctx, len, seg + 1);
+        return;
+    }
+
+    ctx->path[len] = '\0';
+    dir = scanDir(len ? ctx->path : ".");
+    if (dir == NULL)
+        return;
+    matches = arenaAlloc(&lineArena, dir->num * sizeof(GLOBENT *) + 1);
+
+    for (int i = 0; i < dir->num; ++i)
+    {
+        const GLOBENT *ent = &dir->ents[i];
+
+        if (!matchGlob(pat, ent) || len + ent->len + 2 > sizeof(ctx->path))
+            continue;
+        if (wantDir)
+        {
+            memcpy(ctx->path + len, ent->name, ent->len + 1);
+            if (!isDirEntry(ent, ctx->path))
+                continue;
+        }
+        matches[matchNum++] = ent;
+    }
+
+    if (matchNum > 1)
+        qsort(matches, matchNum, sizeof(GLOBENT *), wantDir ? compareDirEntries : compareEntries);
+    for (int i = 0; i < matchNum; ++i)
+    {
+        memcpy(ctx->path + len, matches[i]->name, matches[i]->len);
+        if (last)
+        {
+            pushMatch(ctx, len + matches[i]->len);
+            continue;
+        }
+        ctx->path[len + matches[i]->len] = '/';
+        globWalk(ctx, len + matches[i]->len + 1, seg + 1);
+    }
+}
+
+// pattern을 확장해 out에 넣는다. 맞는 경로가 없으면 0
+static int expandGlob(const char *pattern, VEC *out)
+{
+    GLOBCTX *ctx = arenaAlloc(&lineArena, sizeof(GLOBCTX));
+    size_t len = strlen(pattern);
+    size_t start = 0;
+
+    ctx->segs = arenaAlloc(&lineArena, (len / 2 + 1) * sizeof(GLOBPAT));
+    ctx->segNum = 0;
+    ctx->dirOnly = len > 0 && pattern[len - 1] == '/';
+    ctx->out = out;
+    ctx->found = 0;
+
+    // '/' 로 나눈다 (빈 부분은 건너뛴다. \ 뒤의 글자는 건너뛴다)
+    for (size_t i = 0; i <= len; ++i)
+    {
+        if (i < len && pattern[i] == '\\')
+        {
+            ++i;
+            continue;
+        }
+        if (i == len || pattern[i] == '/')
+        {
+            if (i > start)
+                compileGlob(&ctx->segs[ctx->segNum++], pattern + start, i - start);
+            start = i + 1;
+        }
+    }
+    if (ctx->segNum == 0)
+        return 0;
+
+    if (pattern[0] == '/')
+    {
+        ctx->path[0] = '/';
+        globWalk(ctx, 1, 0);
+    }
+    else
+    {
+        globWalk(ctx, 0, 0);
+    }
+    return ctx->found;
+}
+
+// STATUS_MARK를 지금의 $? 값으로 바꾼 새 문자열 (아레나)
+static char *expandStatus(const char *word)
+{
+    char num[16];
+    int numLen = sprintf(num, "%d", lastStatus);
+    size_t marks = 0;
+    char *out;
+    char *o;
+
+    for (const char *p = word; (p = strchr(p, STATUS_MARK)) != NULL; ++p)
+        marks++;
+    if (marks == 0)
+        return (char *)word;
+
+    out = o = arenaAlloc(&lineArena, strlen(word) + marks * numLen + 1);
+    for (const char *p = word; *p; ++p)
+    {
+        if (*p == STATUS_MARK)
+        {
+            memcpy(o, num, numLen);
+            o += numLen;
+        }
+        else
+        {
+            *o++ = *p;
+        }
+    }
+    *o = '\0';
+    return out;
+}
+
+// 실행 직전에 $?를 지금 값으로 바꾸고 glob 패턴을 경로 이름으로 펼친 argv를 만든다
+// 맞는 경로가 없는 패턴은 (이스케이프만 풀고) 그대로 남긴다
+static void expandStage(STAGE *stage)
+{
+    VEC argv = {NULL, 0, 0};
+
+    if (!stage->expand && !stage->globs)
+        return;
+    for (int i = 0; i < stage->argc; ++i)
+    {
+        char *word = stage->expand ? expandStatus(stage->argv[i]) : stage->argv[i];
+
+        if (stage->globs && stage->globs[i])
+        {
+            if (expandGlob(word, &argv) == 0)
+                vecPush(&lineArena, &argv, unescapeGlob(&lineArena, word));
+        }
+        else
+        {
+            vecPush(&lineArena, &argv, word);
+        }
+    }
+    for (REDIR *r = stage->redirs; stage->expand && r; r = r->next)
+    {
+        if (r->target)
+            r->target = expandStatus(r->target);
+    }
+    stage->argv = (char **)argv.items;
+    stage->argc = argv.num;
+    stage->globs = NULL;
+}
+
+static long tvUs(const struct timeval *tv)
+{
+    return tv->tv_sec * 1000000L + tv->tv_usec;
+}
+
+static void printTimeUs(const char *label, long us)
+{
+    fprintf(stderr, "%s\t%ldm%ld.%03lds\n", label, us / 60000000, us / 1000000 % 60, us / 1000 % 1000);
+}
+
+// time 파이프라인: 앞의 time을 떼고 실행한 뒤 자원 사용량을 표준 에러로 출력한다
+// user/sys/문맥 교환은 그동안 회수한 자식(RUSAGE_CHILDREN)과 셸 자신(빌트인 단계)의 증가분
+// 최대 RSS는 wait4로 받은 자식별 값 중 가장 큰 것 (자식이 없으면 셸의 값)
+static int runTimedPipeline(PIPELINE *pl)
+{
+    struct rusage self0, child0, self1, child1;
+    uint64_t start, wall;
+    int code;
+
+    pl->stages[0]->argv++;
+    pl->stages[0]->argc--;
+    if (pl->stages[0]->globs)
+        pl->stages[0]->globs++;
+
+    childPeakRss = 0;
+    getrusage(RUSAGE_SELF, &self0);
+    getrusage(RUSAGE_CHILDREN, &child0);
+    start = nowNs();
+
+    code = runPipeline(pl);
+
+    wall = nowNs() - start;
+    getrusage(RUSAGE_SELF, &self1);
+    getrusage(RUSAGE_CHILDREN, &child1);
+
+    fflush(stdout);
+    fputc('\n', stderr);
+    printTimeUs("real", (long)(wall / 1000));
+    printTimeUs("user", tvUs(&self1.ru_utime) - tvUs(&self0.ru_utime) + tvUs(&child1.ru_utime) - tvUs(&child0.ru_utime));
+    printTimeUs("sys", tvUs(&self1.ru_stime) - tvUs(&self0.ru_stime) + tvUs(&child1.ru_stime) - tvUs(&child0.ru_stime));
+    fprintf(stderr, "maxrss\t%ldKB\n", childPeakRss ? childPeakRss : self1.ru_maxrss);
+    fprintf(stderr, "csw\t%ld voluntary, %ld involuntary\n",
+            self1.ru_nvcsw - self0.ru_nvcsw + child1.ru_nvcsw - child0.ru_nvcsw,
+            self1.ru_nivcsw - self0.ru_nivcsw + child1.ru_nivcsw - child0.ru_nivcsw);
+    return code;
+}
+
+// ; && || 규칙대로 파이프라인을 차례로 실행한다
+// && 와 || 는 건너뛴 파이프라인의 상태를 바꾸지 않으므로 왼쪽부터 차례로 평가하면 된다
+void runList(CMDLIST *list)
+{
+    for (int i = 0; i < list->pipeNum && !exitShell; ++i)
+    {
+        PIPELINE *pl = list->pipes[i];
+        uint64_t start = traceFile ? nowNs() : 0;
+
+        if ((pl->op == OP_AND && lastStatus != 0) || (pl->op == OP_OR && lastStatus == 0))
+            continue;
+        if (pl->stages[0]->argc > 1 && !strcmp(pl->stages[0]->argv[0], "time"))
+            lastStatus = runTimedPipeline(pl);
+        else
+            lastStatus = runPipeline(pl);
+
+        if (traceFile)
+        {
+            char *text = pipelineText(pl);
+            tracePipeline(text, start, nowNs(), lastStatus);
+            free(text);
+        }
+    }
+}
+
+// 리다이렉션을 왼쪽부터 적용해 fds를 바꾼다. 연 파일은 files에 남겨 나중에 닫는다
+// 셸에서 열어야 오류 메시지에 파일 이름을 보여 줄 수 있다
+static int openRedirects(STAGE *stage, int fds[3], int files[3])
+{
+    for (REDIR *r = stage->redirs; r; r = r->next)
+    {
+        int fd;
+
+        if (r->type == REDIR_DUP)
+        {
+            // 물려받는 디스크립터를 가리키면 복제해 둔다 (spawn file action의 dup2 순서와 무관하도록)
+            fd = fds[r->dupFd] >= 0 ? fcntl(fds[r->dupFd], F_DUPFD_CLOEXEC, 3) : fcntl(r->dupFd, F_DUPFD_CLOEXEC, 3);
+            if (fd < 0)
+            {
+                fprintf(stderr, "mysh: %d: %s\n", r->dupFd, strerror(errno));
+                return -1;
+            }
+        }
+        else if (r->type == REDIR_IN)
+        {
+            fd = open(r->target, O_RDONLY | O_CLOEXEC);
+        }
+        else
+        {
+            fd = open(r->target, O_WRONLY | O_CREAT | O_CLOEXEC | (r->type == REDIR_APPEND ? O_APPEND : O_TRUNC),
+                      0666);
+        }
+        if (fd < 0)
+        {
+            fprintf(stderr, "mysh: %s: %s\n", r->target, strerror(errno));
+            return -1;
+        }
+        closeFd(&files[r->fd]);
+        files[r->fd] = fd;
+        fds[r->fd] = fd;
+    }
+    return 0;
+}
+
+// 단계가 실행할 빌트인. cp, ls에 엔진이 모르는 옵션(ls -1, cp -r 등)이 있으면 외부 명령으로 돌린다
+static int findStageBuiltin(STAGE *stage)
+{
+    int idx = findBuiltin(stage->argv[0]);
+
+    if (idx >= 0 && builtin[idx].cmd == cmd_cp && !mycpHandles(stage->argc, stage->argv))
+        return -1;
+    if (idx >= 0 && builtin[idx].cmd == cmd_ls && !mylsHandles(stage->argc, stage->argv))
+        return -1;
+    return idx;
+}
+
+// 표준 입력을 읽는 빌트인 (parallel은 인자 목록을 stdin에서 받을 수 있다)
+static int builtinReadsStdin(int idx)
+{
+    return idx >= 0 && builtin[idx].cmd == cmd_parallel;
+}
+
+// 빌트인은 셸 프로세스 안에서 실행하고 표준 출력/에러만 잠시 바꿔 끼운다
+// 출력은 중간 버퍼 없이 곧바로 파이프나 파일로 들어간다
+// 파이프에 쓰는 (마지막이 아닌) 빌트인 단계는 forkBuiltin으로 돌리므로, 여기서 실행하는 것은 마지막 단계뿐이다
+static int runBuiltinRedirected(int idx, STAGE *stage, const int fds[3])
+{
+    int saved[3] = {-1, -1, -1};
+    int first = builtinReadsStdin(idx) ? 0 : 1;
+    int ret;
+
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = first; i < 3; ++i)
+    {
+        if (fds[i] >= 0)
+        {
+            saved[i] = dup(i);
+            dup2(fds[i], i);
+        }
+    }
+
+    ret = builtin[idx].cmd(stage->argc, stage->argv);
+
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = first; i < 3; ++i)
+    {
+        if (saved[i] >= 0)
+        {
+            dup2(saved[i], i);
+            close(saved[i]);
+        }
+    }
+    return ret;
+}
+
+// 파이프에 쓰는 빌트인 단계를 자식 프로세스에서 실행한다. 셸 안에서 돌리면
+//  - 읽는 쪽이 멈추면(^Z) 셸이 write()에서 막혀 waitForJob에 가지 못하고
+//  - 읽는 쪽이 먼저 끝나도(head) SIGPIPE를 무시하는 셸은 끝까지 출력을 만들고
+//  - 뒤쪽의 parallel이 셸 안에서 읽기 시작하기 전에 파이프가 가득 차 서로 기다린다
+// 자식은 SIGPIPE가 기본 동작이므로 읽는 쪽이 사라지면 바로 끝난다
+// 자식은 exec 하지 않으므로 이 파이프라인의 다른 파이프 끝을 직접 닫아야 EOF가 전달된다
+static pid_t forkBuiltin(int idx, STAGE *stage, const int fds[3], pid_t pgid, int pipes[][2], int pipeNum)
+{
+    static const int sigs[] = {SIGINT, SIGQUIT, SIGPIPE, SIGCHLD, SIGTSTP, SIGTTIN, SIGTTOU};
+    sigset_t mask;
+    pid_t pid;
+
+    fflush(NULL);
+    pid = fork();
+    if (pid < 0)
+    {
+        fprintf(stderr, "Command Error: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid > 0)
+    {
+        // 자식과 부모 양쪽에서 그룹을 정해야 어느 쪽이 먼저 돌아도 같다
+        if (pgid >= 0)
+            setpgid(pid, pgid ? pgid : pid);
+        return pid;
+    }
+
+    if (pgid >= 0)
+        setpgid(0, pgid);
+    for (size_t i = 0; i < sizeof(sigs) / sizeof(sigs[0]); ++i)
+        signal(sigs[i], SIG_DFL);
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    closeFd(&sigchldPipe[0]);
+    closeFd(&sigchldPipe[1]);
+    // 자식의 자식은 이 작업의 프로세스 그룹에 그대로 둔다 (trace는 셸만 쓴다)
+    interactive = 0;
+    traceFile = NULL;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if (fds[i] >= 0 && fds[i] != i)
+            dup2(fds[i], i);
+    }
+    for (int i = 0; i < pipeNum; ++i)
+    {
+        if (pipes[i][0] > 2)
+            close(pipes[i][0]);
+        if (pipes[i][1] > 2)
+            close(pipes[i][1]);
+    }
+
+    prevStatus = lastStatus;
+    lastStatus = 0;
+    builtin[idx].cmd(stage->argc, stage->argv);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(lastStatus & 0xff);
+}
+
+// 모든 단계를 하나의 프로세스 그룹으로 동시에 띄운다
+// 외부 명령 사이의 데이터는 커널 파이프로만 흐르고 셸을 거치지 않는다
+// 포그라운드면 끝날 때까지 기다려 종료 상태를, 백그라운드면 바로 0을 반환
+int runPipeline(PIPELINE *pl)
+{
+    int stageNum = pl->stageNum;
+    int pipes[MAX_STAGES][2];
+    int fds[MAX_STAGES][3];
+    int files[MAX_STAGES][3];
+    int isBuiltin[MAX_STAGES];
+    pid_t pgid = 0;
+    JOB *job;
+
+    for (int i = 0; i < stageNum; ++i)
+        expandStage(pl->stages[i]);
+
+    // 리다이렉션 없는 단일 빌트인은 그대로 실행 (cd, exit 등은 셸 자신을 바꿔야 한다)
+    // 빌트인은 실패해도 0을 돌려주므로 $?는 0 (wait처럼 직접 바꾸는 경우 제외)
+    if (stageNum == 1 && !pl->background && pl->stages[0]->redirs == NULL)
+    {
+        int idx = findStageBuiltin(pl->stages[0]);
+        if (idx >= 0)
+        {
+            prevStatus = lastStatus;
+            lastStatus = 0;
+            exitShell = builtin[idx].cmd(pl->stages[0]->argc, pl->stages[0]->argv);
+            return lastStatus;
+        }
+    }
+
+    job = newJob();
+    if (job == NULL)
+    {
+        fprintf(stderr, "mysh: too many jobs\n");
+        return 1;
+    }
+    job->procNum = stageNum;
+    job->background = pl->background;
+    job->cmd = pipelineText(pl);
+
+    for (int i = 0; i < stageNum; ++i)
+    {
+        job->pids[i] = -1;
+        job->state[i] = PROC_DONE;
+        job->status[i] = 0;
+        fds[i][0] = fds[i][1] = fds[i][2] = -1;
+        files[i][0] = files[i][1] = files[i][2] = -1;
+        pipes[i][0] = pipes[i][1] = -1;
+        isBuiltin[i] = findStageBuiltin(pl->stages[i]);
+    }
+
+    for (int i = 0; i < stageNum - 1; ++i)
+    {
+        if (pipe2(pipes[i], O_CLOEXEC) < 0)
+        {
+            perror("pipe");
+            for (int j = 0; j < stageNum; ++j)
+                job->status[j] = 1 << 8;
+            goto cleanup;
+        }
+    }
+
+    // 외부 명령을 먼저 모두 띄운다
+    for (int i = 0; i < stageNum; ++i)
+    {
+        fds[i][0] = i > 0 ? pipes[i - 1][0] : -1;
+        fds[i][1] = i < stageNum - 1 ? pipes[i][1] : -1;
+
+        // 리다이렉션을 못 연 단계는 실행하지 않는다 (종료 상태 1)
+        if (openRedirects(pl->stages[i], fds[i], files[i]) < 0)
+        {
+            job->status[i] = 1 << 8;
+            isBuiltin[i] = -2;
+            continue;
+        }
+
+        // 대부분의 빌트인은 표준 입력을 읽지 않으므로, 앞 단계는 읽는 쪽이 없는 파이프(EPIPE)를 보게 된다
+        if (isBuiltin[i] >= 0 && i == stageNum - 1)
+        {
+            if (i > 0 && !builtinReadsStdin(isBuiltin[i]))
+                closeFd(&pipes[i - 1][0]);
+            continue;
+        }
+
+        // 작업 제어는 대화형일 때만. 스크립트의 자식은 셸과 같은 그룹에 두어 Ctrl-C를 함께 받는다
+        if (isBuiltin[i] >= 0)
+        {
+            job->pids[i] = forkBuiltin(isBuiltin[i], pl->stages[i], fds[i], interactive ? pgid : -1, pipes, stageNum - 1);
+            isBuiltin[i] = -1;
+        }
+        else
+            job->pids[i] = spawnCommand(pl->stages[i]->argv, fds[i], interactive ? pgid : -1, &job->times[i]);
+        if (job->pids[i] < 0)
+        {
+            job->status[i] = 127 << 8;
+            continue;
+        }
+        job->state[i] = PROC_RUNNING;
+        if (pgid == 0)
+        {
+            pgid = job->pids[i];
+            if (interactive && !pl->background)
+                tcsetpgrp(STDIN_FILENO, pgid);
+        }
+    }
+    job->pgid = pgid;
+
+    // 셸이 들고 있는 파이프 끝은 빌트인이 쓰는 쪽만 남기고 닫는다
+    for (int i = 0; i < stageNum - 1; ++i)
+    {
+        if (!builtinReadsStdin(isBuiltin[i + 1]))
+            closeFd(&pipes[i][0]);
+        if (isBuiltin[i] < 0)
+            closeFd(&pipes[i][1]);
+    }
+
+    // 빌트인 단계는 셸 안에서 실행되므로 백그라운드여도 여기서 끝난다
+    for (int i = 0; i < stageNum; ++i)
+    {
+        if (isBuiltin[i] >= 0)
+        {
+            // cp, ls처럼 lastStatus로 결과를 알리는 빌트인의 상태를 단계의 종료 상태로 남긴다
+            prevStatus = lastStatus;
+            lastStatus = 0;
+            runBuiltinRedirected(isBuiltin[i], pl->stages[i], fds[i]);
+            job->status[i] = (lastStatus & 0xff) << 8;
+            if (i > 0)
+                closeFd(&pipes[i - 1][0]);
+            if (i < stageNum - 1)
+                closeFd(&pipes[i][1]);
+        }
+    }
+
+cleanup:
+    for (int i = 0; i < stageNum; ++i)
+    {
+        closeFd(&pipes[i][0]);
+        closeFd(&pipes[i][1]);
+        for (int j = 0; j < 3; ++j)
+            closeFd(&files[i][j]);
+    }
+
+    // 외부 프로세스가 하나도 없으면 작업으로 남길 것이 없다
+    if (pgid == 0)
+    {
+        int code = jobStatus(job);
+        freeJob(job);
+        return code;
+    }
+
+    if (pl->background)
+    {
+        if (interactive)
+            printf("[%d] %d\n", job->id, pgid);
+        return 0;
+    }
+    return waitForJob(job);
+}
+
+// PATH 검색 결과 캐시 (명령 이름 -> 실행 파일 경로)
+// posix_spawnp()는 실행할 때마다 PATH의 디렉터리를 차례로 execve() 해 보므로
+// 뒤쪽 디렉터리에 있는 명령일수록 실패하는 시스템 호출이 늘어난다
+// PATH 값이 바뀌면 캐시 전체를 버린다
+#define PATH_BUCKETS 64
+
+typedef struct PATHENTRY
+{
+    char *name;
+    char *path;
+    struct PATHENTRY *next;
+} PATHENTRY;
+
+typedef struct PATHCACHE
+{
+    char *pathVar; // 캐시를 만들 때의 PATH 값
+    PATHENTRY *buckets[PATH_BUCKETS];
+} PATHCACHE;
+
+PATHCACHE pathCache;
+
+static unsigned int hashName(const char *name)
+{
+    unsigned int h = 5381;
+    while (*name)
+        h = h * 33 + (unsigned char)*name++;
+    return h % PATH_BUCKETS;
+}
+
+static void clearPathCache(void)
+{
+    for (int i = 0; i < PATH_BUCKETS; ++i)
+    {
+        while (pathCache.buckets[i])
+        {
+            PATHENTRY *e = pathCache.buckets[i];
+            pathCache.buckets[i] = e->next;
+            free(e->name);
+            free(e->path);
+            free(e);
+        }
+    }
+    free(pathCache.pathVar);
+    pathCache.pathVar = NULL;
+}
+
+static void forgetPath(const char *name)
+{
+    PATHENTRY **link = &pathCache.buckets[hashName(name)];
+    for (; *link; link = &(*link)->next)
+    {
+        if (!strcmp((*link)->name, name))
+        {
+            PATHENTRY *e = *link;
+            *link = e->next;
+            free(e->name);
+            free(e->path);
+            free(e);
+            return;
+        }
+    }
+}
+
+// name을 PATH에서 찾아 실행 파일 경로를 돌려준다. 없으면 NULL
+// 반환값은 캐시가 들고 있으므로 해제하지 않는다
+static const char *lookupPath(const char *name)
+{
+    const char *pathVar = getenv("PATH");
+    unsigned int h = hashName(name);
+    char full[PATH_MAX];
+
+    if (pathVar == NULL)
+        pathVar = "/bin:/usr/bin";
+    if (pathCache.pathVar == NULL || strcmp(pathCache.pathVar, pathVar) != 0)
+    {
+        clearPathCache();
+        pathCache.pathVar = strdup(pathVar);
+    }
+
+    for (PATHENTRY *e = pathCache.buckets[h]; e; e = e->next)
+    {
+        if (!strcmp(e->name, name))
+            return e->path;
+    }
+
+    for (const char *dir = pathVar;; ++dir)
+    {
+        const char *end = strchrnul(dir, ':');
+        struct stat st;
+        int len = (int)(end - dir);
+
+        // 빈 항목은 현재 디렉터리
+        if (snprintf(full, sizeof(full), "%.*s%s%s", len, len ? dir : ".", "/", name) < (int)sizeof(full) &&
+            stat(full, &st) == 0 && S_ISREG(st.st_mode) && access(full, X_OK) == 0)
+        {
+            PATHENTRY *e = malloc(sizeof(PATHENTRY));
+            e->name = strdup(name);
+            e->path = strdup(full);
+            e->next = pathCache.buckets[h];
+            pathCache.buckets[h] = e;
+            return e->path;
+        }
+        if (*end == '\0')
+            break;
+        dir = end;
+    }
+    return NULL;
+}
+
+// fork() + execvp() 대신 posix_spawnp()로 자식을 만든다
+// glibc는 이를 clone(CLONE_VM | CLONE_VFORK)로 구현하므로 셸의 주소 공간(페이지 테이블)을
+// 복사하지 않는다. 셸이 커져도 명령 실행 지연이 일정하게 유지된다
+// fds[i]가 0 이상이면 자식의 i번 디스크립터로 dup2 된다 (리다이렉션은 spawn file action으로 전달)
+// pgid가 0이면 자식이 새 프로세스 그룹의 리더가 되고, 양수면 그 그룹에 들어간다 (음수면 그대로)
+// times가 있으면 단계별 시점을 남긴다 (지연 히스토그램, trace)
+pid_t spawnCommand(char *argv[], const int fds[3], pid_t pgid, SPAWNTIME *times)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t mask;
+    pid_t pid;
+    int err;
+
+    if (times)
+        times->start = nowNs();
+
+    posix_spawn_file_actions_init(&actions);
+    for (int i = 0; i < 3; ++i)
+    {
+        if (fds[i] >= 0 && fds[i] != i)
+            posix_spawn_file_actions_adddup2(&actions, fds[i], i);
+    }
+
+    // 셸이 무시하거나 막아 둔 시그널은 자식에서 기본 동작으로 되돌린다
+    posix_spawnattr_init(&attr);
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGQUIT);
+    sigaddset(&mask, SIGPIPE);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGTSTP);
+    sigaddset(&mask, SIGTTIN);
+    sigaddset(&mask, SIGTTOU);
+    posix_spawnattr_setsigdefault(&attr, &mask);
+    posix_spawnattr_setpgroup(&attr, pgid < 0 ? 0 : pgid);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_USEVFORK |
+                                        (pgid >= 0 ? POSIX_SPAWN_SETPGROUP : 0));
+
+    // 프롬프트 등 버퍼에 남은 출력이 자식 출력보다 늦게 나가지 않도록
+    fflush(stdout);
+
+    // 환경 변수는 셸의 environ을 그대로 넘긴다
+    // '/'가 없는 이름은 캐시된 경로로 바로 실행하고, 캐시가 낡았으면(파일이 사라짐 등)
+    // 항목을 버리고 posix_spawnp()로 한 번 더 시도한다 (#!가 없는 스크립트도 이쪽에서 처리된다)
+    if (strchr(argv[0], '/') == NULL)
+    {
+        const char *path = lookupPath(argv[0]);
+        if (times)
+            times->spawn = nowNs();
+        err = path ? posix_spawn(&pid, path, &actions, &attr, argv, environ) : ENOENT;
+        if (err != 0 && path != NULL)
+        {
+            forgetPath(argv[0]);
+            err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+        }
+    }
+    else
+    {
+        if (times)
+            times->spawn = nowNs();
+        err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+    }
+    if (times)
+        times->run = nowNs();
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    // 실패하면 오류를 출력하고 -1을 반환 (자식 프로세스는 만들어지지 않음)
+    if (err != 0)
+    {
+        fprintf(stderr, "Command Error: %s\n", strerror(err));
+        return -1;
+    }
+    return pid;
+}
+
+int cmd_cd(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        char *home;
+        home = getenv("HOME");
+
+        // 홈 디렉터리가 없을 수 있나? 생각했지만 환경 변수를 수정했다면 충분히 가능
+        if (home == NULL)
+        {
+            perror("NO HOME");
+            return 0;
+        }
+        // 환경 변수에 다른 home을 설정했다면 오류 발생 가능
+        if (chdir(home) != 0)
+        {
+            perror("cd");
+            return 0;
+        }
+    }
+    else if (argc == 2)
+    {
+        if (argv[1][0] == '-')
+        {
+            fprintf(stderr, "옵션 지원 안함\n");
+            return 0;
+        }
+        if (chdir(argv[1]) != 0)
+        {
+            perror("cd");
+            return 0;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "cd: too many argumnets\n");
+        return 0;
+    }
+
+    return 0;
+}
+
+int cmd_pwd(int argc, char *argv[])
+{
+    char buffer[STR_LEN];
+    if (getcwd(buffer, sizeof(buffer)) == NULL)
+    {
+        // 현재 디렉터리에 권한이 없거나와 같은 오류
+        perror("pwd");
+        return 0;
+    }
+
+    if (argc >= 2)
+    {
+        if (argv[1][0] == '-')
+        {
+            // 2번째 인자로 옵션 오는 경우는 작동함
+            fprintf(stderr, "옵션 지원 안함\n");
+            return 0;
+        }
+    }
+
+    printf("%s\n", buffer);
+    return 0;
+}
+
+// exit [n]: 셸의 종료 상태는 n, 없으면 마지막 명령의 상태
+int cmd_exit(int argc, char *argv[])
+{
+    if (argc >= 2)
+    {
+        if (!is_number(argv[1]))
+        {
+            fprintf(stderr, "exit: %s: numeric argument required\n", argv[1]);
+            lastStatus = 2;
+            return 1;
+        }
+        lastStatus = atoi(argv[1]) & 0xff;
+    }
+    else
+    {
+        lastStatus = prevStatus;
+    }
+    return 1;
+}
+
+int cmd_help(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        for (int i = 0; i < builtins; ++i)
+        {
             printf("%-10s : %s\n", builtin[i].name, builtin[i].desc);
         }
     }
-    else if (argc >= 2)
+    else if (argc >= 2)
+    {
+        if (argv[1][0] == '-')
+        {
+            fprintf(stderr, "옵션 지원 안함\n");
+            return 0;
+        }
+
+        for (int j = 1; j < argc; ++j)
+        {
+            int isFind = 0;
+
+            if (argv[j][0] == '-')
+            {
+                continue;
+                ;
+            }
+
+            for (int i = 0; i < builtins; ++i)
+            {
+                if (!strncmp(argv[j], builtin[i].name, strlen(argv[j])))
+                {
+                    printf("%-10s : %s\n", builtin[i].name, builtin[i].desc);
+                    isFind = 1;
+                }
+            }
+            if (!isFind)
+            {
+                fprintf(stderr, "help: no help topics match '%s'.\n", argv[1]);
+            }
+        }
+    }
+
+    return 0;
+}
+
+// %n 또는 n 형태의 작업 번호. 인자가 없으면 가장 최근 작업
+static JOB *findJob(const char *name, const char *arg)
+{
+    if (arg == NULL)
+    {
+        for (int i = MAX_JOBS - 1; i >= 0; --i)
+        {
+            if (jobs[i].id && jobs[i].background)
+                return &jobs[i];
+        }
+        fprintf(stderr, "%s: current: no such job\n", name);
+        return NULL;
+    }
+
+    const char *num = arg[0] == '%' ? arg + 1 : arg;
+    if (is_number(num))
+    {
+        int id = atoi(num);
+        if (id >= 1 && id <= MAX_JOBS && jobs[id - 1].id)
+            return &jobs[id - 1];
+    }
+    fprintf(stderr, "%s: %s: no such job\n", name, arg);
+    return NULL;
+}
+
+int cmd_jobs(int argc, char *argv[])
+{
+    reapJobs();
+    for (int i = 0; i < MAX_JOBS; ++i)
+    {
+        if (jobs[i].id == 0 || !jobs[i].background)
+            continue;
+        if (jobIsRunning(&jobs[i]))
+            printf("[%d]   Running                 %s &\n", jobs[i].id, jobs[i].cmd);
+        else if (jobIsStopped(&jobs[i]))
+            printf("[%d]   Stopped                 %s\n", jobs[i].id, jobs[i].cmd);
+    }
+    // 끝난 작업은 여기서 알리고 지운다
+    notifyJobs();
+    return 0;
+}
+
+static void continueJob(JOB *job)
+{
+    for (int i = 0; i < job->procNum; ++i)
+    {
+        if (job->state[i] == PROC_STOPPED)
+            job->state[i] = PROC_RUNNING;
+    }
+    for (int i = 0; i < job->procNum; ++i)
+    {
+        if (job->state[i] == PROC_RUNNING)
+            kill(job->pids[i], SIGCONT);
+    }
+}
+
+int cmd_fg(int argc, char *argv[])
+{
+    JOB *job;
+
+    if (argc > 2)
+    {
+        fprintf(stderr, "fg: too many arguments\n");
+        return 0;
+    }
+    if (!interactive)
+    {
+        fprintf(stderr, "fg: no job control\n");
+        lastStatus = 1;
+        return 0;
+    }
+    job = findJob("fg", argc == 2 ? argv[1] : NULL);
+    if (job == NULL)
+    {
+        lastStatus = 1;
+        return 0;
+    }
+
+    printf("%s\n", job->cmd);
+    fflush(stdout);
+    job->background = 0;
+    if (interactive)
+        tcsetpgrp(STDIN_FILENO, job->pgid);
+    continueJob(job);
+    lastStatus = waitForJob(job);
+    return 0;
+}
+
+int cmd_bg(int argc, char *argv[])
+{
+    JOB *job;
+
+    if (argc > 2)
+    {
+        fprintf(stderr, "bg: too many arguments\n");
+        return 0;
+    }
+    if (!interactive)
+    {
+        fprintf(stderr, "bg: no job control\n");
+        lastStatus = 1;
+        return 0;
+    }
+    job = findJob("bg", argc == 2 ? argv[1] : NULL);
+    if (job == NULL)
+    {
+        lastStatus = 1;
+        return 0;
+    }
+
+    printf("[%d]+ %s &\n", job->id, job->cmd);
+    continueJob(job);
+    return 0;
+}
+
+// 작업이 끝날 때까지(또는 멈출 때까지) 기다린다. 상태 값은 $?에 남는다
+static int waitBackground(JOB *job)
+{
+    struct rusage ru;
+    int status;
+
+    for (int i = 0; i < job->procNum; ++i)
+    {
+        while (job->state[i] == PROC_RUNNING)
+        {
+            if (wait4(job->pids[i], &status, WUNTRACED, &ru) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                job->state[i] = PROC_DONE;
+                break;
+            }
+            markProcess(job->pids[i], status, &ru);
+        }
+    }
+    if (jobIsStopped(job))
+        return 128 + SIGTSTP;
+
+    int code = jobStatus(job);
+    freeJob(job);
+    return code;
+}
+
+int cmd_wait(int argc, char *argv[])
+{
+    if (argc == 1)
     {
-        if (argv[1][0] == '-')
+        lastStatus = 0;
+        for (int i = 0; i < MAX_JOBS; ++i)
         {
-            fprintf(stderr, "옵션 지원 안함\n");
-            return 0;
+            if (jobs[i].id && jobs[i].background)
+                waitBackground(&jobs[i]);
         }
+        return 0;
+    }
 
-        for (int j = 1; j < argc; ++j)
+    for (int i = 1; i < argc; ++i)
+    {
+        JOB *job = findJob("wait", argv[i]);
+        lastStatus = job ? waitBackground(job) : 127;
+    }
+    return 0;
+}
+
+// parallel이 돌리는 작업 하나. 출력은 끝날 때까지 모아 두었다가 한꺼번에 내보낸다
+typedef struct PJOB
+{
+    pid_t pid;
+    int pidfd; // 종료 알림용, 지원하지 않는 커널이면 -1
+    int seq;   // 입력 순서 (-k)
+    int fd[2]; // 자식의 stdout, stderr를 읽는 파이프 (EOF면 -1)
+    char *buf[2];
+    size_t len[2];
+    size_t cap[2];
+    int exited;
+    int code;
+} PJOB;
+
+// parallel 옵션과 진행 상태
+typedef struct PARALLEL
+{
+    char **tmpl;  // 명령 템플릿 ({}가 인자로 바뀜)
+    int tmplNum;
+    char **args;  // ::: 뒤의 인자, NULL이면 stdin에서 한 줄씩
+    int argNum;
+    FILE *in;
+    int nextArg;
+    int keepOrder; // -k
+    int halt;      // -e: 실패하면 새 작업을 시작하지 않음, -E: 실행 중인 작업도 종료
+    int seq;
+    int flushSeq;
+    int failed;
+    int interrupted; // 작업이 SIGINT/SIGQUIT로 죽으면 그 시그널 번호 (^C), 새 작업을 시작하지 않는다
+    int stopped;     // 작업이 멈춤 (^Z), 나머지를 끝내고 돌아간다
+    pid_t pgid; // 대화형일 때만 작업들을 한 그룹으로 묶는다
+    pid_t leader;
+    int devNull;
+    PJOB **slots;
+    int maxJobs;
+    PJOB **done; // -k에서 순서를 기다리는 끝난 작업
+    int doneNum;
+} PARALLEL;
+
+// 실행 중인 프로세스 수를 빼서 CPU 수만큼만 돌린다
+static int defaultJobs(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    double load[1];
+    int n;
+
+    if (cpus < 1)
+        cpus = 1;
+    n = cpus;
+    if (getloadavg(load, 1) == 1)
+        n = cpus - (int)load[0];
+    return n < 1 ? 1 : n;
+}
+
+// 다음 인자. 더 없으면 NULL (반환값은 호출한 쪽이 free)
+static char *nextParallelArg(PARALLEL *par)
+{
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    if (par->args)
+        return par->nextArg < par->argNum ? strdup(par->args[par->nextArg++]) : NULL;
+
+    while ((len = getline(&line, &cap, par->in)) >= 0)
+    {
+        if (len > 0 && line[len - 1] == '\n')
+            line[--len] = '\0';
+        if (len > 0)
+            return line;
+    }
+    free(line);
+    return NULL;
+}
+
+// 템플릿의 {}를 인자로 바꾼 argv. {}가 없으면 인자를 맨 뒤에 붙인다
+static char **buildParallelArgv(PARALLEL *par, const char *arg)
+{
+    char **argv = calloc(par->tmplNum + 2, sizeof(char *));
+    size_t argLen = strlen(arg);
+    int replaced = 0;
+    int i;
+
+    for (i = 0; i < par->tmplNum; ++i)
+    {
+        const char *src = par->tmpl[i];
+        const char *hit;
+        size_t n = 0;
+
+        for (hit = strstr(src, "{}"); hit; hit = strstr(hit + 2, "{}"))
+            n++;
+        argv[i] = malloc(strlen(src) + n * argLen + 1);
+
+        char *out = argv[i];
+        while ((hit = strstr(src, "{}")) != NULL)
         {
-            int isFind = 0;
+            memcpy(out, src, hit - src);
+            out += hit - src;
+            memcpy(out, arg, argLen);
+            out += argLen;
+            src = hit + 2;
+        }
+        strcpy(out, src);
+        replaced += n > 0;
+    }
+    if (!replaced)
+        argv[i++] = strdup(arg);
+    argv[i] = NULL;
+    return argv;
+}
 
-            if (argv[j][0] == '-')
+static void freeArgv(char **argv)
+{
+    for (int i = 0; argv[i]; ++i)
+        free(argv[i]);
+    free(argv);
+}
+
+static int startParallelJob(PARALLEL *par, PJOB *pj, const char *arg)
+{
+    int out[2], err[2];
+    char **argv;
+
+    memset(pj, 0, sizeof(PJOB));
+    pj->fd[0] = pj->fd[1] = pj->pidfd = -1;
+    pj->seq = par->seq++;
+
+    if (pipe2(out, O_CLOEXEC) < 0)
+        return -1;
+    if (pipe2(err, O_CLOEXEC) < 0)
+    {
+        close(out[0]);
+        close(out[1]);
+        return -1;
+    }
+
+    int fds[3] = {par->devNull, out[1], err[1]};
+    argv = buildParallelArgv(par, arg);
+    pj->pid = spawnCommand(argv, fds, interactive ? par->pgid : -1, NULL);
+    freeArgv(argv);
+    close(out[1]);
+    close(err[1]);
+
+    pj->fd[0] = out[0];
+    pj->fd[1] = err[0];
+    fcntl(out[0], F_SETFL, O_NONBLOCK);
+    fcntl(err[0], F_SETFL, O_NONBLOCK);
+
+    // 실행 실패 (명령 없음 등)는 바로 끝난 작업으로 처리
+    if (pj->pid < 0)
+    {
+        pj->exited = 1;
+        pj->code = 127;
+        return 0;
+    }
+
+    if (interactive && par->pgid == 0)
+    {
+        par->pgid = par->leader = pj->pid;
+        if (interactive)
+            tcsetpgrp(STDIN_FILENO, par->pgid);
+    }
+    pj->pidfd = syscall(SYS_pidfd_open, pj->pid, 0);
+    return 0;
+}
+
+// 파이프에 쌓인 출력을 모두 읽어 버퍼에 붙인다
+static void drainParallelOutput(PJOB *pj, int i)
+{
+    ssize_t n;
+
+    for (;;)
+    {
+        if (pj->cap[i] - pj->len[i] < 4096)
+        {
+            pj->cap[i] = pj->cap[i] ? pj->cap[i] * 2 : 8192;
+            pj->buf[i] = realloc(pj->buf[i], pj->cap[i]);
+        }
+        n = read(pj->fd[i], pj->buf[i] + pj->len[i], pj->cap[i] - pj->len[i]);
+        if (n > 0)
+        {
+            pj->len[i] += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        closeFd(&pj->fd[i]);
+        return;
+    }
+}
+
+// 아직 돌고 있는 작업을 모두 끝낸다. 멈춘 작업도 SIGCONT를 받아야 SIGTERM을 처리한다
+static void terminateParallelJobs(PARALLEL *par)
+{
+    for (int i = 0; i < par->maxJobs; ++i)
+    {
+        if (par->slots[i] && !par->slots[i]->exited && par->slots[i]->pid > 0)
+        {
+            kill(par->slots[i]->pid, SIGTERM);
+            kill(par->slots[i]->pid, SIGCONT);
+        }
+    }
+}
+
+// ^Z: 셸에는 parallel 자체를 작업으로 남길 방법이 없으므로 나머지 작업을 끝내고 터미널을 되찾는다
+static void stopParallel(PARALLEL *par)
+{
+    if (par->stopped)
+        return;
+    par->stopped = 1;
+    terminateParallelJobs(par);
+    if (interactive && par->pgid > 0)
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+    fprintf(stderr, "\nparallel: stopped, terminating running jobs\n");
+}
+
+// 종료했는지(또는 멈췄는지) 확인. 그룹 리더는 다른 작업이 같은 그룹에 들어올 수 있도록 좀비로 남겨 둔다
+static void checkParallelExit(PARALLEL *par, PJOB *pj)
+{
+    siginfo_t info;
+    int options = WEXITED | WSTOPPED | WNOHANG;
+
+    if (pj->exited)
+        return;
+    if (pj->pid == par->leader)
+        options |= WNOWAIT;
+
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PID, pj->pid, &info, options) < 0 || info.si_pid == 0)
+        return;
+    if (info.si_code == CLD_STOPPED)
+    {
+        stopParallel(par);
+        return;
+    }
+
+    pj->exited = 1;
+    pj->code = info.si_code == CLD_EXITED ? info.si_status : 128 + info.si_status;
+    if ((info.si_code == CLD_KILLED || info.si_code == CLD_DUMPED) &&
+        (info.si_status == SIGINT || info.si_status == SIGQUIT))
+        par->interrupted = info.si_status;
+    closeFd(&pj->pidfd);
+}
+
+static void flushParallelJob(PJOB *pj)
+{
+    fwrite(pj->buf[0], 1, pj->len[0], stdout);
+    fflush(stdout);
+    fwrite(pj->buf[1], 1, pj->len[1], stderr);
+    free(pj->buf[0]);
+    free(pj->buf[1]);
+    free(pj);
+}
+
+// 끝난 작업의 출력을 내보낸다. -k면 입력 순서가 될 때까지 기다린다
+static void finishParallelJob(PARALLEL *par, PJOB *pj)
+{
+    if (pj->code != 0)
+    {
+        par->failed++;
+        // -E 또는 ^C 이면 실행 중인 작업도 끝낸다
+        if (par->halt == 2 || par->interrupted)
+            terminateParallelJobs(par);
+    }
+
+    if (!par->keepOrder)
+    {
+        flushParallelJob(pj);
+        return;
+    }
+
+    par->done = realloc(par->done, (par->doneNum + 1) * sizeof(PJOB *));
+    par->done[par->doneNum++] = pj;
+    for (int i = 0; i < par->doneNum;)
+    {
+        if (par->done[i]->seq != par->flushSeq)
+        {
+            ++i;
+            continue;
+        }
+        flushParallelJob(par->done[i]);
+        par->done[i] = par->done[--par->doneNum];
+        par->flushSeq++;
+        i = 0;
+    }
+}
+
+// parallel [-j N] [-k] [-e | -E] command [{}] ... [::: arg ...]
+// 인자마다 명령을 하나씩 실행하되 항상 N개가 돌도록 채운다
+// 종료는 pidfd를 poll 해서 기다리고 (지원하지 않으면 짧은 주기로 waitid), 출력은 작업 단위로 묶는다
+int cmd_parallel(int argc, char *argv[])
+{
+    PARALLEL par;
+    PJOB **slots;
+    struct pollfd *pfds;
+    int maxJobs = 0;
+    int running = 0;
+    int usePidfd = 1;
+    int i;
+
+    memset(&par, 0, sizeof(par));
+    for (i = 1; i < argc && argv[i][0] == '-'; ++i)
+    {
+        if (!strcmp(argv[i], "-k"))
+        {
+            par.keepOrder = 1;
+        }
+        else if (!strcmp(argv[i], "-e"))
+        {
+            par.halt = 1;
+        }
+        else if (!strcmp(argv[i], "-E"))
+        {
+            par.halt = 2;
+        }
+        else if (!strncmp(argv[i], "-j", 2))
+        {
+            const char *num = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+            if (!is_number(num) || atoi(num) < 1)
             {
+                fprintf(stderr, "parallel: -j: invalid job count '%s'\n", num);
+                lastStatus = 2;
+                return 0;
+            }
+            maxJobs = atoi(num);
+        }
+        else
+        {
+            fprintf(stderr, "parallel: %s: invalid option\n", argv[i]);
+            fprintf(stderr, "usage: parallel [-j N] [-k] [-e|-E] command [{}] ... [::: arg ...]\n");
+            lastStatus = 2;
+            return 0;
+        }
+    }
+
+    par.tmpl = &argv[i];
+    for (; i < argc && strcmp(argv[i], ":::") != 0; ++i)
+        par.tmplNum++;
+    if (par.tmplNum == 0)
+    {
+        fprintf(stderr, "usage: parallel [-j N] [-k] [-e|-E] command [{}] ... [::: arg ...]\n");
+        lastStatus = 2;
+        return 0;
+    }
+    if (i < argc)
+    {
+        par.args = &argv[i + 1];
+        par.argNum = argc - i - 1;
+    }
+    else
+    {
+        // 셸의 stdin 버퍼와 섞이지 않도록 디스크립터를 따로 연다
+        par.in = fdopen(dup(STDIN_FILENO), "r");
+        if (par.in == NULL)
+        {
+            perror("parallel");
+            lastStatus = 1;
+            return 0;
+        }
+    }
+    if (maxJobs == 0)
+        maxJobs = defaultJobs();
+
+    par.devNull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    slots = calloc(maxJobs, sizeof(PJOB *));
+    par.slots = slots;
+    par.maxJobs = maxJobs;
+    pfds = calloc(maxJobs * 3 + 1, sizeof(struct pollfd));
+    fflush(stdout);
+
+    for (;;)
+    {
+        char *arg;
+
+        // 빈 자리를 새 작업으로 채운다
+        for (int s = 0; s < maxJobs && !(par.halt && par.failed) && !par.interrupted && !par.stopped; ++s)
+        {
+            if (slots[s])
                 continue;
-                ;
+            arg = nextParallelArg(&par);
+            if (arg == NULL)
+                break;
+            slots[s] = malloc(sizeof(PJOB));
+            if (startParallelJob(&par, slots[s], arg) < 0)
+            {
+                perror("parallel");
+                free(slots[s]);
+                slots[s] = NULL;
+                free(arg);
+                par.failed++;
+                break;
             }
+            if (slots[s]->pidfd < 0 && slots[s]->pid > 0)
+                usePidfd = 0;
+            free(arg);
+            running++;
+        }
+        if (running == 0)
+            break;
 
-            for (int i = 0; i < builtins; ++i)
+        int n = 0;
+        for (int s = 0; s < maxJobs; ++s)
+        {
+            if (!slots[s])
+                continue;
+            for (int k = 0; k < 2; ++k)
             {
-                if (!strncmp(argv[j], builtin[i].name, strlen(argv[j])))
+                if (slots[s]->fd[k] >= 0)
                 {
-                    printf("%-10s : %s\n", builtin[i].name, builtin[i].desc);
-                    isFind = 1;
+                    pfds[n].fd = slots[s]->fd[k];
+                    pfds[n++].events = POLLIN;
                 }
             }
-            if (!isFind)
+            if (slots[s]->pidfd >= 0)
             {
-                fprintf(stderr, "help: no help topics match '%s'.\n", argv[1]);
+                pfds[n].fd = slots[s]->pidfd;
+                pfds[n++].events = POLLIN;
+            }
+        }
+        // pidfd는 종료만 알리므로 멈춤(^Z)은 SIGCHLD 파이프로 깨어나 waitid로 확인한다
+        if (sigchldPipe[0] >= 0)
+        {
+            pfds[n].fd = sigchldPipe[0];
+            pfds[n++].events = POLLIN;
+        }
+        if (poll(pfds, n, usePidfd ? -1 : 10) < 0 && errno != EINTR)
+        {
+            perror("parallel: poll");
+            break;
+        }
+        // 여기서 비워도 reapJobs는 작업 테이블 전체를 확인하므로 배경 작업 회수는 빠지지 않는다
+        if (sigchldPipe[0] >= 0)
+        {
+            char drain[64];
+            while (read(sigchldPipe[0], drain, sizeof(drain)) > 0)
+                ;
+        }
+
+        for (int s = 0; s < maxJobs; ++s)
+        {
+            PJOB *pj = slots[s];
+            if (!pj)
+                continue;
+            for (int k = 0; k < 2; ++k)
+            {
+                if (pj->fd[k] >= 0)
+                    drainParallelOutput(pj, k);
+            }
+            checkParallelExit(&par, pj);
+            if (pj->exited && pj->fd[0] < 0 && pj->fd[1] < 0)
+            {
+                slots[s] = NULL;
+                running--;
+                finishParallelJob(&par, pj);
             }
         }
     }
 
+    // 그룹 리더를 마지막으로 회수하고 터미널을 되찾는다
+    if (par.leader > 0)
+        waitpid(par.leader, NULL, 0);
+    if (interactive && par.pgid > 0)
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+
+    for (i = 0; i < par.doneNum; ++i)
+        flushParallelJob(par.done[i]);
+    free(par.done);
+    free(slots);
+    free(pfds);
+    if (par.in)
+        fclose(par.in);
+    closeFd(&par.devNull);
+
+    if (par.stopped)
+        lastStatus = 128 + SIGTSTP;
+    else if (par.interrupted)
+        lastStatus = 128 + par.interrupted;
+    else
+        lastStatus = par.failed > 101 ? 101 : par.failed;
+    return 0;
+}
+
+// cp, ls: mycp, myls와 같은 엔진(myfileops.c)을 셸 프로세스 안에서 실행한다
+// 프로세스를 만들지 않으므로 짧은 복사나 목록 출력이 spawn 비용 없이 끝난다
+// 엔진은 exit() 하지 않고 종료 상태를 돌려주며, 그 값은 $?가 된다
+// 쓰기 오류(EPIPE 등)로 엔진이 멈추면 stdout의 오류 표시를 지워 다음 명령에 남기지 않는다
+NAMECACHE nameCache; // uid/gid 이름은 셸이 살아 있는 동안 재사용
+
+int cmd_cp(int argc, char *argv[])
+{
+    lastStatus = mycpMain(argc, argv);
+    return 0;
+}
+
+int cmd_ls(int argc, char *argv[])
+{
+    lastStatus = mylsMain(argc, argv, &nameCache);
+    fflush(stdout);
+    clearerr(stdout);
+    return 0;
+}
+
+// 파이프라인 앞의 time은 runList가 처리한다. 여기에 오는 것은 명령 없는 time 또는 파이프라인 중간의 time
+int cmd_time(int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        fprintf(stderr, "time: must come first in a pipeline\n");
+        lastStatus = 2;
+        return 0;
+    }
+    fputc('\n', stderr);
+    printTimeUs("real", 0);
+    printTimeUs("user", 0);
+    printTimeUs("sys", 0);
+    return 0;
+}
+
+static void printHistogram(const HISTOGRAM *h)
+{
+    char avg[16], max[16], lo[16], hi[16];
+    uint64_t peak = 0;
+
+    if (h->num == 0)
+    {
+        printf("%-6s no samples\n", h->name);
+        return;
+    }
+    printf("%-6s n=%llu avg=%s max=%s\n", h->name, (unsigned long long)h->num, formatNs(avg, h->total / h->num),
+           formatNs(max, h->max));
+    for (int k = 0; k < HIST_BUCKETS; ++k)
+    {
+        if (h->count[k] > peak)
+            peak = h->count[k];
+    }
+    for (int k = 0; k < HIST_BUCKETS; ++k)
+    {
+        if (h->count[k] == 0)
+            continue;
+        formatNs(lo, k ? (1ULL << k) * 1000 : 0);
+        formatNs(hi, (2ULL << k) * 1000);
+        printf("  [%9s, %9s) %8llu ", lo, hi, (unsigned long long)h->count[k]);
+        for (uint64_t n = (h->count[k] * 40 + peak - 1) / peak; n > 0; --n)
+            putchar('#');
+        putchar('\n');
+    }
+}
+
+// stats               히스토그램 출력
+// stats on|off|reset  기록 켜기, 끄기, 비우기
+// stats trace 파일    이후 명령을 Chrome trace JSON으로 기록 (stats trace off 로 닫기)
+int cmd_stats(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        if (!statsEnabled)
+            printf("stats: recording is off (stats on or MYSH_STATS=1)\n");
+        for (int i = 0; i < PHASES; ++i)
+            printHistogram(&latency[i]);
+        return 0;
+    }
+    if (!strcmp(argv[1], "on"))
+        statsEnabled = 1;
+    else if (!strcmp(argv[1], "off"))
+        statsEnabled = 0;
+    else if (!strcmp(argv[1], "reset"))
+    {
+        for (int i = 0; i < PHASES; ++i)
+        {
+            const char *name = latency[i].name;
+            memset(&latency[i], 0, sizeof(HISTOGRAM));
+            latency[i].name = name;
+        }
+    }
+    else if (!strcmp(argv[1], "trace") && argc == 3)
+    {
+        if (!strcmp(argv[2], "off"))
+            closeTrace();
+        else if (openTrace(argv[2]) < 0)
+            lastStatus = 1;
+    }
+    else
+    {
+        fprintf(stderr, "usage: stats [on|off|reset|trace file|trace off]\n");
+        lastStatus = 2;
+    }
     return 0;
 }
 